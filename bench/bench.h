@@ -0,0 +1,87 @@
+#ifndef __3DE_BENCH_H__
+#define __3DE_BENCH_H__
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* Timing and JSON reporting shared by the benchmark suite. A suite prints
+ * one JSON document on stdout :
+ *
+ * {"suite":"object","revision":"0ec062b","flags":"-DOBJ_GC","results":[
+ *   {"name":"field_get","param":16,"ops":2000000,"ns_per_op":12.3},
+ *   ...
+ * ]}
+ *
+ * Every measure is the best of BENCH_RUNS runs. param is the size the
+ * benchmark was run at (field count, container length...), or 0.
+ * The Makefile defines BENCH_REVISION and BENCH_FLAGS. */
+
+#ifndef BENCH_REVISION
+#define BENCH_REVISION "unknown"
+#endif
+#ifndef BENCH_FLAGS
+#define BENCH_FLAGS ""
+#endif
+#define BENCH_RUNS 5
+
+typedef void (*bench_fn)(void *arg, long ops);
+
+static int bench_results;
+
+static inline double bench_now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+static inline void bench_string(const char *s){
+	putchar('"');
+	while(*s){
+		if(*s == '"' || *s == '\\'){
+			putchar('\\');
+		}
+		putchar(*s++);
+	}
+	putchar('"');
+}
+static inline void bench_begin(const char *suite){
+	printf("{\"suite\":");
+	bench_string(suite);
+	printf(",\"revision\":");
+	bench_string(BENCH_REVISION);
+	printf(",\"flags\":");
+	bench_string(BENCH_FLAGS);
+	printf(",\"results\":[");
+	bench_results = 0;
+}
+/* bytes is the output size for throughput benchmarks, 0 otherwise */
+static inline void bench_report(const char *name, long param, long ops, double seconds, long bytes){
+	printf(bench_results++ ? ",\n  " : "\n  ");
+	printf("{\"name\":");
+	bench_string(name);
+	printf(",\"param\":%ld,\"ops\":%ld,\"ns_per_op\":%.3f",param,ops,seconds/ops*1e9);
+	if(bytes){
+		printf(",\"bytes\":%ld,\"mb_per_s\":%.1f",bytes,bytes*1e-6/seconds);
+	}
+	printf("}");
+	fflush(stdout);
+}
+/* runs fn(arg,ops) BENCH_RUNS times and returns the best time */
+static inline double bench_time(bench_fn fn, void *arg, long ops){
+	double best = 1e30;
+	int r;
+	for(r = 0; r < BENCH_RUNS; r++){
+		double t = bench_now();
+		fn(arg,ops);
+		t = bench_now() - t;
+		best = t < best ? t : best;
+	}
+	return best;
+}
+static inline void bench_measure(const char *name, long param, bench_fn fn, void *arg, long ops){
+	bench_report(name,param,ops,bench_time(fn,arg,ops),0);
+}
+static inline void bench_end(void){
+	printf("\n]}\n");
+}
+
+#endif
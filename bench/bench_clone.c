@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "object.h"
+
+/* Snapshotting a configuration graph every tick: the time to clone it and
+ * to clone it and write one element to the clone, against a deep clone.
+ * Prints its results as JSON, see bench.h */
+
+#define ELEMENTS	1000000
+#define FIELDS		10000
+#define TICKS		100
+
+typedef struct graph_s{
+	obj_t	*object;
+	int	table;		/* written by field rather than by index */
+}graph_t;
+
+static void clone(void *arg, long ops){
+	graph_t *g = (graph_t*)arg;
+	while(ops--){
+		obj_unref(obj_clone(g->object));
+	}
+}
+static void clone_write(void *arg, long ops){
+	graph_t *g = (graph_t*)arg;
+	long i;
+	for(i = 0; i < ops; i++){
+		obj_t *c = obj_clone(g->object);
+		if(g->table){
+			obj_set_field(c,"field0",tmp(obj_new(Int,(int)-i)));
+		}else{
+			obj_set_index(c,(int)i,tmp(obj_new(Int,(int)-i)));
+		}
+		obj_unref(c);
+	}
+}
+static void clone_deep(void *arg, long ops){
+	graph_t *g = (graph_t*)arg;
+	while(ops--){
+		obj_unref(obj_clone_deep(g->object));
+	}
+}
+/* param is the element or field count */
+static void run(const char *name, obj_t *o, int param, int table, int deep){
+	graph_t g;
+	char n[64];
+	g.object = o;
+	g.table = table;
+	snprintf(n,sizeof(n),"%s_clone",name);
+	bench_measure(n,param,clone,&g,TICKS);
+	snprintf(n,sizeof(n),"%s_clone_write",name);
+	bench_measure(n,param,clone_write,&g,TICKS);
+	if(deep){
+		snprintf(n,sizeof(n),"%s_clone_deep",name);
+		bench_measure(n,param,clone_deep,&g,1);
+	}
+}
+
+int main(int argc, char **argv){
+	obj_t *list = obj_new(List), *array = obj_new(Array,0), *table = obj_new(HashTable);
+	char key[32];
+	int i;
+	for(i = 0; i < ELEMENTS; i++){
+		list_append(list,tmp(obj_new(Int,i)));
+		array_append(array,tmp(obj_new(Int,i)));
+	}
+	for(i = 0; i < FIELDS; i++){
+		snprintf(key,sizeof(key),"field%d",i);
+		obj_set_field(table,key,tmp(obj_new(Int,i)));
+	}
+	bench_begin("clone");
+	run("list",list,ELEMENTS,0,1);
+	run("array",array,ELEMENTS,0,1);
+	run("table",table,FIELDS,1,0);
+	bench_end();
+	obj_unref(list);
+	obj_unref(array);
+	obj_unref(table);
+	return 0;
+}
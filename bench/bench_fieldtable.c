@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "object.h"
+
+/* Compares obj_get_field against the chained field table it used before,
+ * and against lookups by atom which skip the string hashing, param is the
+ * field count. Prints its results as JSON, see bench.h */
+
+#define LOOKUPS 2000000
+
+/*	CHAINED TABLE, as it was	*/
+typedef struct cfield_s{
+	char *key;
+	unsigned int hash;
+	obj_t *data;
+	struct cfield_s *next;
+}cfield_t;
+
+typedef struct cfieldtable_s{
+	int table_length;
+	int field_count;
+	cfield_t **table;
+}cfieldtable_t;
+
+static unsigned int hash_string(const char *str, int str_len){
+	unsigned int hash = 5381;
+	int i = str_len;
+	while(i--){
+		hash = (hash << 5) + hash + str[i];
+	}
+	return hash;
+}
+static cfieldtable_t *cnew(void){
+	cfieldtable_t *ft = malloc(sizeof(cfieldtable_t));
+	ft->table_length = 2;
+	ft->field_count = 0;
+	ft->table = calloc(ft->table_length,sizeof(cfield_t*));
+	return ft;
+}
+static void cinsert(cfieldtable_t *ft, obj_t *object, const char *key){
+	cfield_t *f = malloc(sizeof(cfield_t));
+	int index;
+	f->key = malloc(strlen(key) + 1);
+	strcpy(f->key,key);
+	f->hash = hash_string(key,strlen(key));
+	f->data = object;
+	f->next = ft->table[f->hash % ft->table_length];
+	index = f->hash % ft->table_length;
+	ft->table[index] = f;
+	ft->field_count++;
+}
+static obj_t *cget(const cfieldtable_t *ft, const char *key){
+	unsigned int hash = hash_string(key,strlen(key));
+	cfield_t *f = ft->table[hash % ft->table_length];
+	while(f){
+		if(f->hash == hash && !strcmp(f->key,key)){
+			return f->data;
+		}
+		f = f->next;
+	}
+	return NULL;
+}
+static void cfree(cfieldtable_t *ft){
+	int i = ft->table_length;
+	while(i--){
+		cfield_t *f = ft->table[i];
+		while(f){
+			cfield_t *next = f->next;
+			free(f->key);
+			free(f);
+			f = next;
+		}
+	}
+	free(ft->table);
+	free(ft);
+}
+
+typedef struct fields_s{
+	char		(*keys)[24];
+	const atom_t	**atoms;
+	obj_t		*object;
+	cfieldtable_t	*chained;
+	int		count;
+}fields_t;
+
+static obj_t * volatile sink;
+
+static void chained_get(void *arg, long ops){
+	fields_t *f = (fields_t*)arg;
+	long i;
+	for(i = 0; i < ops; i++){
+		sink = cget(f->chained,f->keys[i % f->count]);
+	}
+}
+static void open_get(void *arg, long ops){
+	fields_t *f = (fields_t*)arg;
+	long i;
+	for(i = 0; i < ops; i++){
+		sink = obj_get_field(f->object,f->keys[i % f->count]);
+	}
+}
+static void atom_get(void *arg, long ops){
+	fields_t *f = (fields_t*)arg;
+	long i;
+	for(i = 0; i < ops; i++){
+		sink = obj_get_field_atom(f->object,f->atoms[i % f->count]);
+	}
+}
+static void run(int count){
+	obj_t *v = obj_new(Int,1);
+	fields_t f;
+	int i;
+	f.keys = malloc(count*sizeof(*f.keys));
+	f.atoms = malloc(count*sizeof(atom_t*));
+	f.object = obj_new(Object);
+	f.chained = cnew();
+	f.count = count;
+	for(i = 0; i < count; i++){
+		snprintf(f.keys[i],24,"field_%d",i);
+		cinsert(f.chained,v,f.keys[i]);
+		obj_set_field(f.object,f.keys[i],v);
+		f.atoms[i] = atom(f.keys[i]);
+	}
+	bench_measure("chained_get",count,chained_get,&f,LOOKUPS);
+	bench_measure("field_get",count,open_get,&f,LOOKUPS);
+	bench_measure("field_get_atom",count,atom_get,&f,LOOKUPS);
+	cfree(f.chained);
+	obj_unref(f.object);
+	obj_unref(v);
+	free(f.keys);
+	free(f.atoms);
+}
+
+int main(int argc, char **argv){
+	int counts[] = {2,8,32,128,512};
+	int i;
+	bench_begin("fieldtable");
+	for(i = 0; i < (int)(sizeof(counts)/sizeof(counts[0])); i++){
+		run(counts[i]);
+	}
+	bench_end();
+	return 0;
+}
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "object.h"
+
+/* The object.c suite : allocation churn, field access at growing field
+ * counts, indexed access in List and Array, and printing throughput.
+ * Prints its results as JSON, see bench.h */
+
+#define CHURN		1000000
+#define FIELD_OPS	2000000
+#define INDEX_OPS	4000000
+#define PRINT_LENGTH	1000000
+
+static obj_t *sink;
+
+/*	ALLOCATION	*/
+static void new_object(void *arg, long ops){
+	while(ops--){
+		obj_unref(obj_new(Object));
+	}
+}
+static void new_int(void *arg, long ops){
+	while(ops--){
+		obj_unref(obj_new(Int,(int)ops));
+	}
+}
+static void new_float(void *arg, long ops){
+	while(ops--){
+		obj_unref(obj_new(Float,(double)ops));
+	}
+}
+static void new_string(void *arg, long ops){
+	while(ops--){
+		obj_unref(obj_new(String,"a short string"));
+	}
+}
+/* keeps a window of live objects so that the slabs are not just
+ * recycling the same slot */
+static void new_window(void *arg, long ops){
+	obj_t *window[256] = {NULL};
+	long i;
+	for(i = 0; i < ops; i++){
+		obj_unref(window[i & 255]);
+		window[i & 255] = obj_new(Float,(double)i);
+	}
+	for(i = 0; i < 256; i++){
+		obj_unref(window[i]);
+	}
+}
+
+/*	FIELDS	*/
+typedef struct fields_s{
+	obj_t *object;
+	char (*keys)[16];
+	int count;
+}fields_t;
+
+static void field_get(void *arg, long ops){
+	fields_t *f = (fields_t*)arg;
+	long i;
+	for(i = 0; i < ops; i++){
+		sink = obj_get_field(f->object,f->keys[i % f->count]);
+	}
+}
+static void field_set(void *arg, long ops){
+	fields_t *f = (fields_t*)arg;
+	long i;
+	for(i = 0; i < ops; i++){
+		obj_set_field(f->object,f->keys[i % f->count],sink);
+	}
+}
+static void fields(void){
+	static const int counts[] = {1, 4, 16, 64, 256, 1024, 0};
+	int c, i;
+	for(c = 0; counts[c]; c++){
+		fields_t f;
+		f.count = counts[c];
+		f.object = obj_new(Object);
+		f.keys = malloc(f.count*sizeof(*f.keys));
+		for(i = 0; i < f.count; i++){
+			snprintf(f.keys[i],sizeof(f.keys[i]),"field%d",i);
+			obj_set_field(f.object,f.keys[i],tmp(obj_new(Int,i)));
+		}
+		sink = obj_get_field(f.object,f.keys[0]);
+		bench_measure("field_get",f.count,field_get,&f,FIELD_OPS);
+		bench_measure("field_set",f.count,field_set,&f,FIELD_OPS);
+		obj_unref(f.object);
+		free(f.keys);
+	}
+}
+
+/*	INDEXED ACCESS	*/
+typedef struct indexed_s{
+	obj_t *container;
+	int length;
+	int *order;
+}indexed_t;
+
+static void index_sequential(void *arg, long ops){
+	indexed_t *x = (indexed_t*)arg;
+	long i;
+	for(i = 0; i < ops; i++){
+		sink = obj_get_index(x->container,(int)(i % x->length));
+	}
+}
+static void index_random(void *arg, long ops){
+	indexed_t *x = (indexed_t*)arg;
+	long i;
+	for(i = 0; i < ops; i++){
+		sink = obj_get_index(x->container,x->order[i % x->length]);
+	}
+}
+static void indexed(void){
+	static const int lengths[] = {16, 1024, 65536, 0};
+	int l, i;
+	for(l = 0; lengths[l]; l++){
+		indexed_t list, array;
+		int *order = malloc(lengths[l]*sizeof(int));
+		list.container = obj_new(List);
+		array.container = obj_new(Array,0);
+		list.length = array.length = lengths[l];
+		list.order = array.order = order;
+		for(i = 0; i < lengths[l]; i++){
+			obj_t *o = obj_new(Float,(double)i);
+			list_append(list.container,o);
+			array_append(array.container,o);
+			obj_unref(o);
+			order[i] = rand() % lengths[l];
+		}
+		bench_measure("list_index_sequential",lengths[l],index_sequential,&list,INDEX_OPS);
+		bench_measure("array_index_sequential",lengths[l],index_sequential,&array,INDEX_OPS);
+		/* random List access walks the nodes, keep the large case short */
+		bench_measure("list_index_random",lengths[l],index_random,&list,
+				lengths[l] > 4096 ? INDEX_OPS/64 : INDEX_OPS);
+		bench_measure("array_index_random",lengths[l],index_random,&array,INDEX_OPS);
+		obj_unref(list.container);
+		obj_unref(array.container);
+		free(order);
+	}
+}
+
+/*	PRINTING	*/
+typedef struct printed_s{
+	obj_t *object;
+	FILE *file;
+	size_t length;
+}printed_t;
+
+static void print_file(void *arg, long ops){
+	printed_t *p = (printed_t*)arg;
+	obj_printf(p->file,p->object);
+	fflush(p->file);
+}
+static void print_buffer(void *arg, long ops){
+	printed_t *p = (printed_t*)arg;
+	free(obj_to_buffer(p->object,&p->length));
+}
+static void printing(void){
+	static const char *files[] = {"print_ints","print_floats","print_mixed"};
+	static const char *buffers[] = {"buffer_ints","buffer_floats","buffer_mixed"};
+	FILE *null = fopen("/dev/null","w");
+	printed_t p;
+	double t;
+	int i, kind;
+	if(!null){
+		fprintf(stderr,"ERROR: cannot open /dev/null\n");
+		return;
+	}
+	for(kind = 0; kind < 3; kind++){
+		p.object = obj_new(List);
+		p.file = null;
+		for(i = 0; i < PRINT_LENGTH; i++){
+			switch(kind == 2 ? i % 3 : kind){
+			case 0: list_append(p.object,tmp(obj_new(Int,rand() - RAND_MAX/2))); break;
+			case 1: list_append(p.object,tmp(obj_new(Float,rand()*1e-4))); break;
+			case 2: list_append(p.object,tmp(obj_new(String,"node \"name\""))); break;
+			}
+		}
+		print_buffer(&p,0);
+		t = bench_time(print_file,&p,PRINT_LENGTH);
+		bench_report(files[kind],PRINT_LENGTH,PRINT_LENGTH,t,(long)p.length);
+		t = bench_time(print_buffer,&p,PRINT_LENGTH);
+		bench_report(buffers[kind],PRINT_LENGTH,PRINT_LENGTH,t,(long)p.length);
+		obj_unref(p.object);
+	}
+	fclose(null);
+}
+
+int main(int argc, char **argv){
+	srand(1);
+	bench_begin("object");
+	bench_measure("new_unref_object",0,new_object,NULL,CHURN);
+	bench_measure("new_unref_int",0,new_int,NULL,CHURN);
+	bench_measure("new_unref_float",0,new_float,NULL,CHURN);
+	bench_measure("new_unref_string",0,new_string,NULL,CHURN);
+	bench_measure("new_unref_window",256,new_window,NULL,CHURN);
+	fields();
+	indexed();
+	printing();
+	bench_end();
+	return 0;
+}
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "parser.h"
+#include "vector.h"
+
+/* Parser throughput on documents printed by obj_printf(), fed in 64KB
+ * chunks as they would come from a file, param is the number of values
+ * in the document. For reference the numbers document is also scanned
+ * with plain strtod(). Prints its results as JSON, see bench.h */
+
+#define ELEMENTS	1000000
+#define CHUNK		65536
+
+typedef struct document_s{
+	const char	*name;
+	char		*text;
+	size_t		length;
+}document_t;
+
+static double sum;
+
+static void drop(obj_t *value, void *ctx){
+	obj_unref(value);
+}
+static void parse(void *arg, long ops){
+	document_t *d = (document_t*)arg;
+	parser_t *p = parser_new(drop,NULL);
+	size_t off;
+	for(off = 0; off < d->length; off += CHUNK){
+		parser_feed(p,d->text + off,d->length - off < CHUNK ? d->length - off : CHUNK);
+	}
+	if(!parser_end(p)){
+		fprintf(stderr,"%s: %s\n",d->name,parser_error(p));
+	}
+	parser_free(p);
+}
+static void scan_strtod(void *arg, long ops){
+	document_t *d = (document_t*)arg;
+	const char *s = d->text + 1;
+	char *end;
+	while(*s && *s != ']'){
+		sum += strtod(s,&end);
+		s = end + 1;
+	}
+}
+/* prints and releases o */
+static void run(const char *name, obj_t *o, long values, bench_fn fn){
+	document_t d;
+	d.name = name;
+	d.text = obj_to_buffer(o,&d.length);
+	obj_unref(o);
+	bench_report(name,values,values,bench_time(parse,&d,values),(long)d.length);
+	if(fn){
+		bench_report("strtod",values,values,bench_time(fn,&d,values),(long)d.length);
+	}
+	free(d.text);
+}
+
+int main(int argc, char **argv){
+	obj_t *numbers = obj_new(Array,0), *strings = obj_new(Array,0), *mixed = obj_new(Array,0);
+	int i;
+	srand(1);
+	for(i = 0; i < ELEMENTS; i++){
+		array_append(numbers,tmp(i & 1 ? obj_new(Int,rand()) : obj_new(Float,rand()*1e-4)));
+	}
+	for(i = 0; i < ELEMENTS/4; i++){
+		char s[32];
+		snprintf(s,sizeof(s),"string number %d",rand());
+		array_append(strings,tmp(obj_new(String,s)));
+	}
+	for(i = 0; i < ELEMENTS/16; i++){
+		obj_t *t = obj_new(HashTable);
+		obj_set_field(t,"id",tmp(obj_new(Int,i)));
+		obj_set_field(t,"name",tmp(obj_new(String,"node")));
+		obj_set_field(t,"position",tmp(obj_new(Vec,rand()*1e-6,rand()*1e-6,rand()*1e-6,1.0)));
+		array_append(mixed,t);
+		obj_unref(t);
+	}
+	bench_begin("parser");
+	run("numbers",numbers,ELEMENTS,scan_strtod);
+	run("strings",strings,ELEMENTS/4,NULL);
+	run("mixed",mixed,ELEMENTS/16,NULL);
+	bench_end();
+	return 0;
+}
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "object.h"
+#include "vector.h"
+
+/* Printing throughput of large containers, to /dev/null through
+ * obj_printf() and to memory through obj_to_buffer(), param is the
+ * element count. For reference the same numbers are also printed with
+ * one fprintf() per element, as the print callbacks used to. Prints its
+ * results as JSON, see bench.h */
+
+#define ELEMENTS	10000000
+
+typedef struct printed_s{
+	const obj_t	*object;
+	FILE		*file;
+	size_t		length;		/* of the last print */
+	int		floats;		/* for fprintf */
+}printed_t;
+
+static void print_file(void *arg, long ops){
+	printed_t *p = (printed_t*)arg;
+	obj_printf(p->file,p->object);
+	fflush(p->file);
+}
+static void print_buffer(void *arg, long ops){
+	printed_t *p = (printed_t*)arg;
+	free(obj_to_buffer(p->object,&p->length));
+}
+static void print_fprintf(void *arg, long ops){
+	printed_t *p = (printed_t*)arg;
+	obj_t *o = (obj_t*)p->object;
+	int i, n = obj_len(o);
+	long bytes = fprintf(p->file,"[");
+	for(i = 0; i < n; i++){
+		if(p->floats){
+			bytes += fprintf(p->file,"%f",floatarray_data(o)[i]);
+		}else{
+			bytes += fprintf(p->file,"%d",intarray_data(o)[i]);
+		}
+		bytes += fprintf(p->file," ");
+	}
+	bytes += fprintf(p->file,"]");
+	fflush(p->file);
+	p->length = bytes;
+}
+/* reference is -1 for containers that have no fprintf() reference, else
+ * whether they hold floats */
+static void run(const char *name, const obj_t *o, int elements, FILE *null, int reference){
+	printed_t p;
+	char n[64];
+	double t;
+	p.object = o;
+	p.file = null;
+	p.floats = reference > 0;
+	t = bench_time(print_buffer,&p,elements);
+	snprintf(n,sizeof(n),"%s_buffer",name);
+	bench_report(n,elements,elements,t,(long)p.length);
+	t = bench_time(print_file,&p,elements);
+	snprintf(n,sizeof(n),"%s_file",name);
+	bench_report(n,elements,elements,t,(long)p.length);
+	if(reference >= 0){
+		t = bench_time(print_fprintf,&p,elements);
+		snprintf(n,sizeof(n),"%s_fprintf",name);
+		bench_report(n,elements,elements,t,(long)p.length);
+	}
+}
+
+int main(int argc, char **argv){
+	obj_t *ints = obj_new(IntArray,0), *floats = obj_new(FloatArray,0), *mixed = obj_new(List);
+	FILE *null = fopen("/dev/null","w");
+	int i;
+	if(!null){
+		fprintf(stderr,"ERROR: cannot open /dev/null\n");
+		return 1;
+	}
+	srand(1);
+	for(i = 0; i < ELEMENTS; i++){
+		intarray_append(ints,rand() - RAND_MAX/2);
+		floatarray_append(floats,rand()*1e-4f);
+	}
+	for(i = 0; i < ELEMENTS/10; i++){
+		switch(i % 4){
+		case 0: list_append(mixed,tmp(obj_new(Int,rand()))); break;
+		case 1: list_append(mixed,tmp(obj_new(Float,rand()*1e-6))); break;
+		case 2: list_append(mixed,tmp(obj_new(String,"node \"name\""))); break;
+		case 3: list_append(mixed,tmp(obj_new(Vec,rand()*1e-6,rand()*1e-6,0.0,1.0))); break;
+		}
+	}
+	bench_begin("print");
+	run("ints",ints,ELEMENTS,null,0);
+	run("floats",floats,ELEMENTS,null,1);
+	run("mixed",mixed,ELEMENTS/10,null,-1);
+	bench_end();
+	obj_unref(ints);
+	obj_unref(floats);
+	obj_unref(mixed);
+	fclose(null);
+	return 0;
+}
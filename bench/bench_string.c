@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "object.h"
+
+/* Creating, hashing and comparing short, inline and long Strings, param
+ * is their length. Each string is hashed several times, as it would be
+ * when used as a key. Prints its results as JSON, see bench.h */
+
+#define STRINGS	1000000
+#define HASHES	8
+
+typedef struct strings_s{
+	obj_t	**s;
+	char	text[256];
+	int	length;
+}strings_t;
+
+static unsigned int sum;
+static int equal;
+
+/* creates ops strings in x->s, each differing from the previous one */
+static void create(strings_t *x, long ops){
+	long i;
+	for(i = 0; i < ops; i++){
+		x->text[i % x->length] = 'a' + i % 26;
+		x->s[i] = string_from_text(x->text,x->length);
+	}
+}
+static void release(strings_t *x, long ops){
+	long i;
+	for(i = 0; i < ops; i++){
+		obj_unref(x->s[i]);
+	}
+}
+static void hash(void *arg, long ops){
+	strings_t *x = (strings_t*)arg;
+	long i;
+	for(i = 0; i < ops; i++){
+		sum += obj_hash(x->s[i % STRINGS]);
+	}
+}
+static void equals(void *arg, long ops){
+	strings_t *x = (strings_t*)arg;
+	long i;
+	for(i = 1; i <= ops; i++){
+		equal += obj_equals(x->s[(i - 1) % STRINGS],x->s[i % STRINGS]);
+	}
+}
+static void run(const char *name, int length){
+	strings_t x;
+	double best = 1e30;
+	char n[64];
+	int r, j;
+	x.s = (obj_t**)malloc(STRINGS*sizeof(obj_t*));
+	x.length = length;
+	for(j = 0; j < length; j++){
+		x.text[j] = 'a' + j % 26;
+	}
+	/* only creation is timed, not the release */
+	for(r = 0; r < BENCH_RUNS; r++){
+		double t = bench_now();
+		create(&x,STRINGS);
+		t = bench_now() - t;
+		best = t < best ? t : best;
+		if(r + 1 < BENCH_RUNS){
+			release(&x,STRINGS);
+		}
+	}
+	snprintf(n,sizeof(n),"%s_new",name);
+	bench_report(n,length,STRINGS,best,0);
+	snprintf(n,sizeof(n),"%s_hash",name);
+	bench_measure(n,length,hash,&x,(long)STRINGS*HASHES);
+	snprintf(n,sizeof(n),"%s_equals",name);
+	bench_measure(n,length,equals,&x,STRINGS - 1);
+	release(&x,STRINGS);
+	free(x.s);
+}
+
+int main(int argc, char **argv){
+	bench_begin("string");
+	run("short",8);
+	run("inline",31);
+	run("long",200);
+	bench_end();
+	return 0;
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "bench.h"
+#include "object.h"
+
+/* Refcount and allocation stress, run with 1,2,4... threads up to the
+ * number of cores, param is the thread count and ops counts the work of
+ * every thread. Prints its results as JSON, see bench.h */
+
+#ifndef OBJ_THREADS
+#error "bench_threads needs the library built with -DOBJ_THREADS"
+#endif
+
+#define ITERATIONS 1000000
+
+static obj_t *shared;
+
+/* every thread refs and unrefs the same object */
+static void *shared_refs(void *arg){
+	int i;
+	for(i = 0; i < ITERATIONS; i++){
+		obj_unref(obj_ref(shared));
+	}
+	return NULL;
+}
+/* every thread refs and unrefs its own thread local object */
+static void *local_refs(void *arg){
+	obj_t *o = obj_new(Object);
+	int i;
+	obj_set_local(o);
+	for(i = 0; i < ITERATIONS; i++){
+		obj_unref(obj_ref(o));
+	}
+	obj_unref(o);
+	return NULL;
+}
+/* every thread creates and destroys objects */
+static void *churn(void *arg){
+	int i;
+	for(i = 0; i < ITERATIONS/10; i++){
+		obj_unref(obj_new(Object));
+	}
+	return NULL;
+}
+
+typedef struct threaded_s{
+	void	*(*fn)(void*);
+	int	threads;
+}threaded_t;
+
+static void spawn(void *arg, long ops){
+	threaded_t *x = (threaded_t*)arg;
+	pthread_t *t = malloc(x->threads*sizeof(pthread_t));
+	int i;
+	for(i = 0; i < x->threads; i++){
+		pthread_create(&t[i],NULL,x->fn,NULL);
+	}
+	for(i = 0; i < x->threads; i++){
+		pthread_join(t[i],NULL);
+	}
+	free(t);
+}
+static void run(const char *name, void *(*fn)(void*), int threads, long ops){
+	threaded_t x;
+	x.fn = fn;
+	x.threads = threads;
+	bench_report(name,threads,threads*ops,bench_time(spawn,&x,ops),0);
+}
+
+int main(int argc, char **argv){
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	int threads;
+	shared = obj_new(Object);
+	bench_begin("threads");
+	for(threads = 1; threads <= cores || threads == 1; threads *= 2){
+		run("shared_refs",shared_refs,threads,ITERATIONS);
+		run("local_refs",local_refs,threads,ITERATIONS);
+		run("churn",churn,threads,ITERATIONS/10);
+	}
+	bench_end();
+	obj_unref(shared);
+	return 0;
+}
@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "vector.h"
+
+/* The vector.c suite : every implemented vec3, vec4 and mat4 kernel, one
+ * call per op, on operands cycling through arrays that fit in L1. The
+ * batch kernels (_n, _soa) report the time per vector.
+ * Prints its results as JSON, see bench.h */
+
+#define OPS	4000000
+#define N	1024		/* vectors, a power of two */
+#define M	64		/* matrices, a power of two */
+
+static vec3_t a[N], b[N], d[N];
+static vec4_t a4[N], d4[N];
+static mat4_t ma[M], mb[M], md[M];
+static float xs[N], ys[N], zs[N];
+static volatile float fsink;
+static volatile int isink;
+
+/* defines k_<name>(), a loop over ops calls of the kernel in body, with
+ * i the op and j, k the operand indexes */
+#define KERNEL(name, body) \
+	static void k_##name(void *arg, long ops){ \
+		long i; \
+		for(i = 0; i < ops; i++){ \
+			int j = (int)i & (N - 1), k = (int)i & (M - 1); \
+			(void)j; (void)k; \
+			body; \
+		} \
+	}
+
+KERNEL(vec3_copy,		vec3_copy(&d[j],&a[j]))
+KERNEL(vec3_add,		vec3_add(&d[j],&a[j]))
+KERNEL(vec3_add2,		vec3_add2(&d[j],&a[j],&b[j]))
+KERNEL(vec3_diff,		vec3_diff(&d[j],&a[j]))
+KERNEL(vec3_diff2,		vec3_diff2(&d[j],&a[j],&b[j]))
+KERNEL(vec3_cross,		vec3_cross(vec3_copy(&d[j],&b[j]),&a[j]))
+KERNEL(vec3_cross2,		vec3_cross2(&d[j],&a[j],&b[j]))
+KERNEL(vec3_proj,		vec3_proj(&d[j],&a[j]))
+KERNEL(vec3_proj2,		vec3_proj2(&d[j],&a[j],&b[j]))
+KERNEL(vec3_neg,		vec3_neg(&d[j]))
+KERNEL(vec3_neg2,		vec3_neg2(&d[j],&a[j]))
+KERNEL(vec3_abs,		vec3_abs(&d[j]))
+KERNEL(vec3_abs2,		vec3_abs2(&d[j],&a[j]))
+KERNEL(vec3_scale,		vec3_scale(&d[j],-1.0f))
+KERNEL(vec3_scale2,		vec3_scale2(&d[j],&a[j],0.5f))
+KERNEL(vec3_equals,		isink += vec3_equals(&a[j],&b[j]))
+KERNEL(vec3_equals_zero,	isink += vec3_equals_zero(&a[j]))
+KERNEL(vec3_dot,		fsink += vec3_dot(&a[j],&b[j]))
+KERNEL(vec3_angle,		fsink += vec3_angle(&a[j],&b[j]))
+KERNEL(vec3_norm,		fsink += vec3_norm(&a[j]))
+KERNEL(vec3_norm_squared,	fsink += vec3_norm_squared(&a[j]))
+KERNEL(vec3_norm_dist,		fsink += vec3_norm_dist(&a[j],&b[j]))
+KERNEL(vec3_normalize,		vec3_normalize(vec3_copy(&d[j],&a[j])))
+KERNEL(vec3_normalize2,		vec3_normalize2(&d[j],&a[j]))
+KERNEL(vec4_homogenize2,	vec4_homogenize2(&d4[j],&a4[j]))
+KERNEL(mat4_zero,		mat4_zero(&md[k]))
+KERNEL(mat4_id,			mat4_id(&md[k]))
+KERNEL(mat4_copy,		mat4_copy(&md[k],&ma[k]))
+KERNEL(mat4_add,		mat4_add(&md[k],&ma[k]))
+KERNEL(mat4_add2,		mat4_add2(&md[k],&ma[k],&mb[k]))
+KERNEL(mat4_diff,		mat4_diff(&md[k],&ma[k]))
+KERNEL(mat4_diff2,		mat4_diff2(&md[k],&ma[k],&mb[k]))
+KERNEL(mat4_mult,		mat4_mult(mat4_copy(&md[k],&ma[k]),&mb[k]))
+KERNEL(mat4_mult2,		mat4_mult2(&md[k],&ma[k],&mb[k]))
+KERNEL(mat4_mult2_vec3,		mat4_mult2_vec3(&d[j],&ma[k],&a[j]))
+KERNEL(mat4_mult2_vec4,		mat4_mult2_vec4(&d4[j],&ma[k],&a4[j]))
+
+/* batch kernels, ops counts vectors */
+static void k_vec3_add_n(void *arg, long ops){
+	for(; ops > 0; ops -= N){
+		vec3_add_n(d,a,N);
+	}
+}
+static void k_vec3_scale_n(void *arg, long ops){
+	for(; ops > 0; ops -= N){
+		vec3_scale_n(d,-1.0f,N);
+	}
+}
+static void k_mat4_mult2_vec3_n(void *arg, long ops){
+	int k = 0;
+	for(; ops > 0; ops -= N){
+		mat4_mult2_vec3_n(d,&ma[k++ & (M - 1)],a,N);
+	}
+}
+static void k_mat4_mult_soa(void *arg, long ops){
+	int k = 0;
+	for(; ops > 0; ops -= N){
+		mat4_mult_soa(&ma[k++ & (M - 1)],xs,ys,zs,N);
+	}
+}
+
+typedef struct kernel_s{
+	const char *name;
+	bench_fn fn;
+}kernel_t;
+
+#define K(name) {#name, k_##name}
+static const kernel_t kernels[] = {
+	K(vec3_copy), K(vec3_add), K(vec3_add2), K(vec3_diff), K(vec3_diff2),
+	K(vec3_cross), K(vec3_cross2), K(vec3_proj), K(vec3_proj2),
+	K(vec3_neg), K(vec3_neg2), K(vec3_abs), K(vec3_abs2),
+	K(vec3_scale), K(vec3_scale2), K(vec3_add_n), K(vec3_scale_n),
+	K(vec3_equals), K(vec3_equals_zero), K(vec3_dot), K(vec3_angle),
+	K(vec3_norm), K(vec3_norm_squared), K(vec3_norm_dist),
+	K(vec3_normalize), K(vec3_normalize2), K(vec4_homogenize2),
+	K(mat4_zero), K(mat4_id), K(mat4_copy), K(mat4_add), K(mat4_add2),
+	K(mat4_diff), K(mat4_diff2), K(mat4_mult), K(mat4_mult2),
+	K(mat4_mult2_vec3), K(mat4_mult2_vec4), K(mat4_mult2_vec3_n), K(mat4_mult_soa),
+	{NULL, NULL}
+};
+
+/* the in place kernels drift, bring the operands back before each one.
+ * Those that would drift into denormals within a run (cross, scale) work
+ * on a copy or scale by -1 */
+static void reset(void){
+	int i, c;
+	srand(1);
+	for(i = 0; i < N; i++){
+		vec3_random(&a[i]);
+		vec3_random(&b[i]);
+		vec3_random(&d[i]);
+		a4[i] = vec4_def(a[i].x,a[i].y,a[i].z,1.0f + a[i].x);
+		xs[i] = a[i].x;
+		ys[i] = a[i].y;
+		zs[i] = a[i].z;
+	}
+	for(i = 0; i < M; i++){
+		for(c = 0; c < 16; c++){
+			((float*)&ma[i])[c] = rand() / (float)RAND_MAX;
+			((float*)&mb[i])[c] = rand() / (float)RAND_MAX;
+		}
+		ma[i].ww = mb[i].ww = 4.0f;
+	}
+}
+
+int main(int argc, char **argv){
+	const kernel_t *k;
+	bench_begin("vector");
+	for(k = kernels; k->name; k++){
+		reset();
+		bench_measure(k->name,0,k->fn,NULL,OPS);
+	}
+	bench_end();
+	return 0;
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include "object.h"
+
+int main(int argc, char **argv){
+	obj_t *i1 = obj_new(Int,1);
+	obj_t *a = obj_new(Array,10);
+	obj_set_index(a,0,i1);
+	obj_printfn(stdout,a);
+	obj_unref(a);
+	return 0;
+}
+/*int main(int argc, char **argv){
+	printf("LIST");
+	obj_t *i1 = obj_new(Int,1);
+	obj_t *i2 = obj_new(Int,2);
+	obj_t *i3 = obj_new(Int,3);
+	obj_t *i4 = obj_new(Int,4);
+	obj_t *l1 = obj_new(List);
+	printf("->append\n");
+	list_append(l1,i1);
+	list_append(l1,i2);
+	list_append(l1,i3);
+	list_append(l1,i4);
+	list_append(l1,tmp(obj_new(Float,3.14)));
+	obj_printfn(stdout,l1);
+	list_remove(l1,1);
+	list_set(l1,1,i4);
+	obj_printfn(stdout,l1);
+	printf("->unref is\n");
+	obj_unref(i1);
+	obj_unref(i2);
+	obj_unref(i3);
+	obj_unref(i4);
+	obj_printfn(stdout,l1);
+	printf("->unref ls\n");
+	obj_unref(l1);
+
+	printf("ARRAY");
+	i1 = obj_new(Int,1);
+	i2 = obj_new(Int,2);
+	i3 = obj_new(Int,3);
+	i4 = obj_new(Int,4);
+	obj_t* a1 = obj_new(Array,10);
+	array_set(a1,0,i1);
+	array_set(a1,2,i2);
+	array_set(a1,3,i3);
+	array_set(a1,9,i4);
+	array_set(a1,8,i4);
+	array_set(a1,7,i4);
+	array_set(a1,0,i4);
+	obj_printfn(stdout,a1);
+	obj_unref(i1);
+	obj_unref(i2);
+	obj_unref(i3);
+	obj_unref(i4);
+	obj_unref(a1);
+
+	return 0;
+}*/
+/*
+int main(int argc, char **argv){
+	obj_printfn(stdout,obj_new(Int,1));
+	obj_printfn(stdout,obj_new(Int,-5));
+	obj_printfn(stdout,obj_new(Int,4092));
+
+	obj_t *ht = obj_new(HashTable);
+	obj_printfn(stdout,ht);
+	hashtable_set(ht,"A",obj_new(Float,3.14));
+	hashtable_set(ht,"B",obj_new(Float,5.16));
+	hashtable_set(ht,"C",obj_new(Float,-9.98));
+	obj_printfn(stdout,ht);
+
+	obj_t *l = obj_new(List);
+	obj_printfn(stdout,l);
+	list_append(l,obj_new(Int,1));
+	list_append(l,obj_new(Int,2));
+	list_append(l,obj_new(Int,3));
+	list_append(l,obj_new(Int,4));
+	obj_printfn(stdout,l);
+
+	obj_printfn(stdout,list_get(l,0));
+	obj_printfn(stdout,list_get(l,1));
+	obj_printfn(stdout,list_get(l,2));
+	obj_printfn(stdout,list_get(l,3));
+
+	obj_t *l2 = obj_new(List);
+	list_append(l2,obj_new(Float,8.0));
+	list_append(l2,obj_new(Float,9.0));
+	list_append(l2,l);
+	obj_printfn(stdout,l2);
+	list_extend(l2,l);
+	obj_printfn(stdout,l2);
+
+	obj_t *a1 = obj_new(Array,10);
+	obj_printfn(stdout,a1);
+	array_set(a1,0,obj_new(Float,1.0));
+	array_set(a1,4,obj_new(Float,4.0));
+	array_set(a1,5,obj_new(Float,5.0));
+	array_set(a1,9,obj_new(Float,9.0));
+	obj_printfn(stdout,a1);
+	obj_printfn(stdout,array_get(a1,0));
+	obj_printfn(stdout,array_get(a1,1));
+	obj_printfn(stdout,array_get(a1,9));
+	
+	return 0;
+}*/
+/*	
+int main(int argc, char **argv){
+	object_t* ob1 = obj_new(Object);
+	obj_set_field(ob1,"key1",obj_new(String,"1"));
+	obj_set_field(ob1,"key2",obj_new(String,"2"));
+	obj_set_field(ob1,"key3",obj_new(String,"3"));
+	obj_set_field(ob1,"key4",obj_new(String,"4"));
+	obj_set_field(ob1,"key5",obj_new(Float,5.62));
+	obj_set_field(ob1,"key6",obj_new(String,"6"));
+	obj_print(obj_set_field(ob1,"key1",obj_new(String,"1bis")),stdout);
+	obj_print(obj_set_field(ob1,"key2",obj_new(String,"2bis")),stdout);
+	obj_print(obj_set_field(ob1,"key3",obj_new(String,"3bis")),stdout);
+	obj_print(obj_get_field(ob1,"key4"),stdout);
+	obj_print(obj_get_field(ob1,"key5"),stdout);
+	obj_print(obj_get_field(ob1,"key6"),stdout);
+	obj_print(obj_get_field(ob1,"key1"),stdout);
+	obj_print(obj_get_field(ob1,"key2"),stdout);
+	obj_print(obj_get_field(ob1,"key3"),stdout);
+	return 0;
+}*/
@@ -0,0 +1,18 @@
+#include <stdio.h>
+#include "vector.h"
+
+int main(int argc, char **argv){
+	mat4_t *m = mat4_zero(mat4_new());
+	obj_t *v1 = obj_new(Vec,1.0,2.0,3.0,4.0);
+	obj_t *f1 = obj_new(Float,3.14);
+	obj_t *m1 = obj_new(Mat,m);
+
+	obj_printfn(stdout,v1);
+	obj_printfn(stdout,f1);
+	obj_printfn(stdout,m1);
+
+	obj_free(v1);
+	obj_free(f1);
+	obj_free(m1);
+	return 0;
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "atom.h"
+#include "sync.h"
+
+#define ATOM_TABLE_MIN	256
+#define ATOM_BLOCK	16384
+
+/* Lookups take no lock: the table is only ever added to, a slot is
+ * published once its atom is written and a grown table once it is filled.
+ * Inserts are locked. A table that was outgrown may still be read, it is
+ * kept on the list of the new one. */
+typedef struct atom_table_s{
+	int			length;
+	struct atom_table_s	*old;
+	const atom_t		*slot[];
+}atom_table_t;
+
+static atom_table_t *table = NULL;
+static int count = 0;
+static sync_lock_t lock = 0;
+
+/* atoms are never freed, they are bump allocated from blocks */
+static char *block = NULL;
+static int   block_used = ATOM_BLOCK;
+
+unsigned int	atom_hash_string(const char *str, int len){
+	unsigned int hash = 5381;
+	int i = len;
+	while(i--){
+		hash = (hash << 5) + hash + str[i];
+	}
+	return hash;
+}
+static atom_t *new_atom(const char *str, int len, unsigned int hash){
+	int size = (sizeof(atom_t) + len + 1 + 7) & ~7;
+	atom_t *a;
+	if(size > ATOM_BLOCK/4){
+		a = malloc(size);
+	}else{
+		if(block_used + size > ATOM_BLOCK){
+			block = malloc(ATOM_BLOCK);
+			block_used = 0;
+			if(!block){
+				block_used = ATOM_BLOCK;
+				fprintf(stderr,"ERROR: atom() out of memory\n");
+				return NULL;
+			}
+		}
+		a = (atom_t*)(block + block_used);
+		block_used += size;
+	}
+	if(!a){
+		fprintf(stderr,"ERROR: atom() out of memory\n");
+		return NULL;
+	}
+	a->hash   = hash;
+	a->length = len;
+	memcpy(a->text,str,len);
+	a->text[len] = '\0';
+	return a;
+}
+static int grow_table(void){
+	int length = table ? table->length*2 : ATOM_TABLE_MIN;
+	atom_table_t *t = calloc(1,sizeof(atom_table_t) + length*sizeof(atom_t*));
+	int i = table ? table->length : 0;
+	if(!t){
+		fprintf(stderr,"ERROR: atom() out of memory\n");
+		return 0;
+	}
+	t->length = length;
+	t->old = table;
+	while(i--){
+		const atom_t *a = table->slot[i];
+		if(a){
+			unsigned int j = a->hash & (length - 1);
+			while(t->slot[j]){
+				j = (j + 1) & (length - 1);
+			}
+			t->slot[j] = a;
+		}
+	}
+	SYNC_STORE(table,t);
+	return 1;
+}
+/* the slot of str in t, or the empty slot that ends its probe */
+static int lookup(const atom_table_t *t, const char *str, int len, unsigned int hash){
+	unsigned int mask = t->length - 1;
+	unsigned int i = hash & mask;
+	const atom_t *a;
+	while((a = SYNC_LOAD(t->slot[i]))){
+		if(a->hash == hash && a->length == len && !memcmp(a->text,str,len)){
+			break;
+		}
+		i = (i + 1) & mask;
+	}
+	return i;
+}
+static const atom_t *find(const char *str, int len, unsigned int hash){
+	const atom_table_t *t = SYNC_LOAD(table);
+	return t ? SYNC_LOAD(t->slot[lookup(t,str,len,hash)]) : NULL;
+}
+const atom_t*	atom_len(const char *str, int len){
+	unsigned int hash = atom_hash_string(str,len);
+	const atom_t *a = find(str,len,hash);
+	int i;
+	if(a){
+		return a;
+	}
+	sync_lock(&lock);
+	if(!table || (count + 1)*2 > table->length){
+		if(!grow_table()){
+			sync_unlock(&lock);
+			return NULL;
+		}
+	}
+	i = lookup(table,str,len,hash);
+	if(!(a = table->slot[i]) && (a = new_atom(str,len,hash))){
+		SYNC_STORE(table->slot[i],a);
+		SYNC_STORE(count,count + 1);
+	}
+	sync_unlock(&lock);
+	return a;
+}
+const atom_t*	atom(const char *str){
+	return atom_len(str,strlen(str));
+}
+const atom_t*	atom_find_len(const char *str, int len){
+	return find(str,len,atom_hash_string(str,len));
+}
+const atom_t*	atom_find(const char *str){
+	return atom_find_len(str,strlen(str));
+}
+int		atom_count(void){
+	return SYNC_LOAD(count);
+}
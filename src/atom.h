@@ -0,0 +1,21 @@
+#ifndef __3DE_ATOM_H__
+#define __3DE_ATOM_H__
+
+/* Interned strings. Every distinct string is stored once, with its hash,
+ * and the handle stays valid for the whole life of the program, so two
+ * atoms are equal if and only if their pointers are equal. */
+
+typedef struct atom_s{
+	unsigned int	hash;
+	int		length;
+	char		text[];
+}atom_t;
+
+unsigned int	atom_hash_string(const char *str, int len);
+const atom_t*	atom(const char *str);
+const atom_t*	atom_len(const char *str, int len);
+const atom_t*	atom_find(const char *str);
+const atom_t*	atom_find_len(const char *str, int len);
+int		atom_count(void);
+
+#endif
@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "object.h"
+#include "slab.h"
+#include "gc.h"
+
+#ifdef OBJ_GC
+
+#define GC_BATCH 256
+
+typedef struct gc_stack_s{
+	obj_t	**item;
+	int	length;
+	int	capacity;
+}gc_stack_t;
+
+static gc_stack_t roots;	/* obj(roots.item[i])->root == i + 1 */
+static gc_stack_t batch;
+static gc_stack_t work;
+static gc_stack_t blacks;
+static gc_stack_t garbage;
+static sync_lock_t roots_lock = 0;
+
+#define color(x) (obj(x)->flags & OBJ_COLOR)
+#define set_color(x,c) (obj(x)->flags = (obj(x)->flags & ~OBJ_COLOR) | (c))
+
+static int push(gc_stack_t *s, obj_t *x){
+	if(s->length == s->capacity){
+		int capacity = s->capacity ? s->capacity*2 : GC_BATCH;
+		obj_t **item = (obj_t**)realloc(s->item,capacity*sizeof(obj_t*));
+		if(!item){
+			fprintf(stderr,"ERROR: gc push() out of memory\n");
+			return 0;
+		}
+		s->item = item;
+		s->capacity = capacity;
+	}
+	s->item[s->length++] = x;
+	return 1;
+}
+static void traverse(obj_t *x, obj_visit_t visit, void *ctx){
+	const klass_t *vt = obj_vt(x);
+	if(vt->traverse){
+		vt->traverse(x,visit,ctx);
+	}
+}
+
+/* purple is every color bit, so coloring purple is an atomic or */
+void	gc_possible_root(obj_t *self){
+	if((SYNC_LOAD(obj(self)->flags) & OBJ_COLOR) == OBJ_PURPLE || slab_in_arena(self)){
+		return;
+	}
+	sync_lock(&roots_lock);
+	if(obj(self)->root || push(&roots,self)){
+		if(!obj(self)->root){
+			obj(self)->root = roots.length;
+		}
+		SYNC_OR(obj(self)->flags,OBJ_PURPLE);
+	}
+	sync_unlock(&roots_lock);
+}
+/* the last root takes the place of the removed one */
+void	gc_forget(obj_t *self){
+	obj_t *last;
+	sync_lock(&roots_lock);
+	if(obj(self)->root){
+		last = roots.item[--roots.length];
+		roots.item[obj(self)->root - 1] = last;
+		obj(last)->root = obj(self)->root;
+		obj(self)->root = 0;
+	}
+	sync_unlock(&roots_lock);
+}
+
+static void visit_gray(obj_t **ref, void *ctx){
+	obj_t *t = *ref;
+	if(t && !obj_is_immediate(t)){
+		obj(t)->refcount--;
+		if(color(t) != OBJ_GRAY){
+			push(&work,t);
+		}
+	}
+}
+static void mark_gray(obj_t *s){
+	push(&work,s);
+	while(work.length){
+		obj_t *x = work.item[--work.length];
+		if(color(x) != OBJ_GRAY){
+			set_color(x,OBJ_GRAY);
+			traverse(x,visit_gray,NULL);
+		}
+	}
+}
+static void visit_black(obj_t **ref, void *ctx){
+	obj_t *t = *ref;
+	if(t && !obj_is_immediate(t)){
+		obj(t)->refcount++;
+		if(color(t) != OBJ_BLACK){
+			set_color(t,OBJ_BLACK);
+			push(&blacks,t);
+		}
+	}
+}
+static void scan_black(obj_t *s){
+	set_color(s,OBJ_BLACK);
+	push(&blacks,s);
+	while(blacks.length){
+		traverse(blacks.item[--blacks.length],visit_black,NULL);
+	}
+}
+static void visit_push(obj_t **ref, void *ctx){
+	obj_t *t = *ref;
+	if(t && !obj_is_immediate(t)){
+		push(&work,t);
+	}
+}
+static void scan(obj_t *s){
+	push(&work,s);
+	while(work.length){
+		obj_t *x = work.item[--work.length];
+		if(color(x) == OBJ_GRAY){
+			if(obj(x)->refcount > 0){
+				scan_black(x);
+			}else{
+				set_color(x,OBJ_WHITE);
+				traverse(x,visit_push,NULL);
+			}
+		}
+	}
+}
+static void collect_white(obj_t *s){
+	push(&work,s);
+	while(work.length){
+		obj_t *x = work.item[--work.length];
+		if(color(x) == OBJ_WHITE){
+			set_color(x,OBJ_BLACK);
+			if(obj(x)->root){
+				gc_forget(x);
+			}
+			push(&garbage,x);
+			traverse(x,visit_push,NULL);
+		}
+	}
+}
+/* The counts of the children were already decremented by mark_gray(),
+ * clearing the references keeps the destructors from doing it again. */
+static void visit_clear(obj_t **ref, void *ctx){
+	*ref = NULL;
+}
+static int collect_batch(int size){
+	int i, freed;
+	sync_lock(&roots_lock);
+	while(batch.length < size && roots.length){
+		obj_t *x = roots.item[--roots.length];
+		obj(x)->root = 0;
+		push(&batch,x);
+	}
+	sync_unlock(&roots_lock);
+	for(i = 0; i < batch.length; i++){
+		if(color(batch.item[i]) == OBJ_PURPLE){
+			mark_gray(batch.item[i]);
+		}else{
+			batch.item[i] = NULL;
+		}
+	}
+	for(i = 0; i < batch.length; i++){
+		if(batch.item[i]){
+			scan(batch.item[i]);
+		}
+	}
+	for(i = 0; i < batch.length; i++){
+		if(batch.item[i]){
+			collect_white(batch.item[i]);
+		}
+	}
+	batch.length = 0;
+	for(i = 0; i < garbage.length; i++){
+		traverse(garbage.item[i],visit_clear,NULL);
+	}
+	for(i = 0; i < garbage.length; i++){
+		obj_free(garbage.item[i]);
+	}
+	freed = garbage.length;
+	garbage.length = 0;
+	return freed;
+}
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+/* A batch cannot stop halfway, the counts of its subgraphs are only
+ * right again once it is scanned. With a budget the batches are sized
+ * from the time a root has taken so far, starting with one root, so that
+ * the next batch fits in what is left. */
+static double root_time = 0.0;	/* seconds per root, running average */
+
+int	obj_gc_collect(int budget_us){
+	double end = now() + budget_us*1e-6;
+	int freed = 0, done = 0;
+	while(obj_gc_pending()){
+		double start = now();
+		int size = GC_BATCH, taken;
+		if(budget_us > 0){
+			double fit = root_time > 0.0 ? (end - start)/root_time : 1.0;
+			if(done && fit < 1.0){
+				break;
+			}
+			size = fit < 1.0 ? 1 : fit < GC_BATCH ? (int)fit : GC_BATCH;
+		}
+		taken = obj_gc_pending() < size ? obj_gc_pending() : size;
+		freed += collect_batch(size);
+		done += taken;
+		if(taken){
+			double t = (now() - start)/taken;
+			root_time = root_time > 0.0 ? (root_time*3 + t)/4 : t;
+		}
+	}
+	return freed;
+}
+int	obj_gc_pending(void){
+	return SYNC_LOAD(roots.length);
+}
+
+#else
+
+void	gc_possible_root(obj_t *self){
+}
+void	gc_forget(obj_t *self){
+}
+int	obj_gc_collect(int budget_us){
+	return 0;
+}
+int	obj_gc_pending(void){
+	return 0;
+}
+
+#endif
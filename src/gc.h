@@ -0,0 +1,40 @@
+#ifndef __3DE_GC_H__
+#define __3DE_GC_H__
+#include "object.h"
+
+/* Trial deletion cycle collector, the synchronous algorithm of Bacon and
+ * Rajan. Built with OBJ_GC, obj_unref() colors purple and records as a
+ * possible root every object whose count drops without reaching zero.
+ * obj_gc_collect() then takes the roots by batches:
+ *  - mark: from each purple root, subtract the references internal to
+ *    the reachable subgraph from the counts, coloring it gray;
+ *  - scan: gray objects left with a count are referenced from outside,
+ *    they and everything they reach are restored and colored black, the
+ *    others are colored white;
+ *  - collect: white objects are garbage, their references are cleared and
+ *    they are freed.
+ * Children are found through the klass traverse() slot. A reference that
+ * a klass does not expose simply keeps its target alive. Arena objects are
+ * never recorded. With OBJ_THREADS recording and forgetting roots is
+ * locked and colors are set atomically, but a collection must not run
+ * while other threads mutate shared objects.
+ * Without OBJ_GC the GC_ macros expand to nothing. */
+
+/* GC_UNREF() comes before the decrement of obj_unref(): the object is
+ * recorded while the reference being dropped still holds it, since
+ * another thread may free it right after. If that decrement turns out
+ * to be the last one, obj_free() forgets the root again. */
+#ifdef OBJ_GC
+#define GC_UNREF(x)		if(SYNC_LOAD(obj(x)->refcount) > 1){ gc_possible_root(x); }
+#define GC_POSSIBLE_ROOT(x)	gc_possible_root(x)
+#define GC_FORGET(x)		if(obj(x)->root){ gc_forget(x); }
+#else
+#define GC_UNREF(x)
+#define GC_POSSIBLE_ROOT(x)
+#define GC_FORGET(x)
+#endif
+
+void	gc_possible_root(obj_t *self);
+void	gc_forget(obj_t *self);
+
+#endif
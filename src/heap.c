@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <string.h>
+#include "heap.h"
+
+heap_usage_t heap_usage[HEAP_KINDS];
+
+static const char *kind_names[HEAP_KINDS] = {
+	"FieldTables",
+	"ListNodes",
+	"StringText",
+	"ArrayStorage",
+	"NumberData"
+};
+
+const char*	heap_kind_name(int kind){
+	if(kind < 0 || kind >= HEAP_KINDS){
+		return NULL;
+	}
+	return kind_names[kind];
+}
+void	heap_klass(const klass_t *klass, heap_klass_t *stats){
+	klass_info_t *info = klass->info;
+	memset(stats,0,sizeof(heap_klass_t));
+	stats->klass = klass;
+	if(!SYNC_LOAD(info->id)){	/* never instanced, the pool is not set up */
+		return;
+	}
+	sync_lock(&info->pool.lock);
+	stats->live = info->pool.live;
+	stats->peak = info->pool.peak;
+	sync_unlock(&info->pool.lock);
+	stats->bytes = (long long)stats->live*info->pool.slot_size;
+	stats->peak_bytes = (long long)stats->peak*info->pool.slot_size;
+}
+void	heap_snapshot(heap_snapshot_t *s){
+	const klass_t *k;
+	int i;
+	s->klass_count = 0;
+	s->bytes = 0;
+	while((k = klass_by_id(s->klass_count + 1))){
+		heap_klass(k,&s->klass[s->klass_count]);
+		s->bytes += s->klass[s->klass_count].bytes;
+		s->klass_count++;
+	}
+	for(i = 0; i < HEAP_KINDS; i++){
+		s->storage[i].bytes  = SYNC_LOAD(heap_usage[i].bytes);
+		s->storage[i].peak   = SYNC_LOAD(heap_usage[i].peak);
+		s->storage[i].blocks = SYNC_LOAD(heap_usage[i].blocks);
+		s->bytes += s->storage[i].bytes;
+	}
+}
+static void diff_line(FILE *f, const char *name, long long count, long long dcount, long long bytes, long long dbytes){
+	if(f){
+		fprintf(f,"%-16s %10lld %+10lld %12lld %+12lld\n",name,count,dcount,bytes,dbytes);
+	}
+}
+int	heap_diff(FILE *f, const heap_snapshot_t *before, const heap_snapshot_t *after){
+	int grown = 0;
+	int i;
+	if(f){
+		fprintf(f,"%-16s %10s %10s %12s %12s\n","","count","delta","bytes","delta");
+	}
+	for(i = 0; i < after->klass_count; i++){
+		const heap_klass_t *b = &after->klass[i];
+		heap_klass_t a = {NULL, 0, 0, 0, 0};
+		if(i < before->klass_count){
+			a = before->klass[i];
+		}
+		if(a.live != b->live){
+			diff_line(f,b->klass->name,b->live,(long long)b->live - a.live,b->bytes,b->bytes - a.bytes);
+			grown += b->live > a.live;
+		}
+	}
+	for(i = 0; i < HEAP_KINDS; i++){
+		const heap_usage_t *a = &before->storage[i], *b = &after->storage[i];
+		if(a->bytes != b->bytes || a->blocks != b->blocks){
+			diff_line(f,kind_names[i],b->blocks,b->blocks - a->blocks,b->bytes,b->bytes - a->bytes);
+			grown += b->bytes > a->bytes;
+		}
+	}
+	if(f){
+		fprintf(f,"%-16s %10s %10s %12lld %+12lld\n","total","","",after->bytes,after->bytes - before->bytes);
+	}
+	return grown;
+}
+void	heap_report(FILE *f){
+	heap_snapshot_t s;
+	int i;
+	heap_snapshot(&s);
+	fprintf(f,"%-16s %10s %10s %12s %12s\n","","live","peak","bytes","peak bytes");
+	for(i = 0; i < s.klass_count; i++){
+		const heap_klass_t *k = &s.klass[i];
+		if(k->peak){
+			fprintf(f,"%-16s %10u %10u %12lld %12lld\n",k->klass->name,k->live,k->peak,k->bytes,k->peak_bytes);
+		}
+	}
+#ifdef OBJ_HEAP_STATS
+	for(i = 0; i < HEAP_KINDS; i++){
+		const heap_usage_t *u = &s.storage[i];
+		fprintf(f,"%-16s %10d %10s %12lld %12lld\n",kind_names[i],u->blocks,"",u->bytes,u->peak);
+	}
+#endif
+	fprintf(f,"%-16s %10s %10s %12lld\n","total","","",s.bytes);
+}
+typedef struct walk_s{
+	const klass_t	*klass;
+	heap_visit_t	visit;
+	void		*ctx;
+	int		count;
+}walk_t;
+
+static void walk_klass(obj_t *self, void *ctx){
+	walk_t *w = (walk_t*)ctx;
+	if(obj_klass(self) == w->klass){
+		w->visit(self,w->ctx);
+		w->count++;
+	}
+}
+int	heap_walk(const klass_t *klass, heap_visit_t visit, void *ctx){
+	walk_t w;
+	if(!klass){
+		return obj_walk(visit,ctx);
+	}
+	w.klass = klass;
+	w.visit = visit;
+	w.ctx = ctx;
+	w.count = 0;
+	return obj_walk(walk_klass,&w) < 0 ? -1 : w.count;
+}
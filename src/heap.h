@@ -0,0 +1,87 @@
+#ifndef __3DE_HEAP_H__
+#define __3DE_HEAP_H__
+#include <stdio.h>
+#include "object.h"
+
+/* Heap introspection. Object slots are counted by the slab pool of each
+ * klass as they are handed out. Built with OBJ_HEAP_STATS, the memory
+ * objects own outside of their slot is also counted here by kind, as it
+ * is allocated and freed; that costs an add or two per allocation, shared
+ * by every thread with OBJ_THREADS. Without it the storage counters stay
+ * 0 and heap_report() leaves them out. Shared storage (see obj_clone())
+ * is counted once. */
+
+enum heap_kind{
+	HEAP_FIELDS,	/* field tables */
+	HEAP_NODES,	/* List nodes and their chunks */
+	HEAP_TEXT,	/* String text too long to be inline */
+	HEAP_ARRAYS,	/* Array element storage */
+	HEAP_NUMBERS,	/* FloatArray, IntArray and vector array data */
+	HEAP_KINDS
+};
+
+typedef struct heap_usage_s{
+	long long	bytes;
+	long long	peak;	/* highest value of bytes */
+	int		blocks;	/* live allocations */
+}heap_usage_t;
+
+extern heap_usage_t heap_usage[HEAP_KINDS];
+
+/* a block of size bytes resized from old bytes, either being 0 when it
+ * is allocated or freed */
+#ifdef OBJ_HEAP_STATS
+static inline void heap_account(int kind, size_t old, size_t size){
+	heap_usage_t *u = &heap_usage[kind];
+	long long bytes = SYNC_ADD(u->bytes,(long long)size - (long long)old);
+	long long peak = SYNC_LOAD(u->peak);
+	if(!old != !size){
+		SYNC_ADD(u->blocks,size ? 1 : -1);
+	}
+	while(bytes > peak && !SYNC_CAS(u->peak,peak,bytes));
+}
+#define HEAP_ALLOC(kind,size)		heap_account((kind),0,(size))
+#define HEAP_FREE(kind,size)		heap_account((kind),(size),0)
+#define HEAP_RESIZE(kind,old,size)	heap_account((kind),(old),(size))
+#else
+#define HEAP_ALLOC(kind,size)		((void)0)
+#define HEAP_FREE(kind,size)		((void)0)
+#define HEAP_RESIZE(kind,old,size)	((void)0)
+#endif
+
+/* The slots of one klass. Instances of its subklasses are counted by
+ * their own klass. */
+typedef struct heap_klass_s{
+	const klass_t	*klass;
+	unsigned int	live;
+	unsigned int	peak;
+	long long	bytes;		/* live slots */
+	long long	peak_bytes;
+}heap_klass_t;
+
+/* Counters of every klass, indexed by klass id - 1, and of every storage
+ * kind, taken at one point. A snapshot is about 8KB. */
+typedef struct heap_snapshot_s{
+	int		klass_count;
+	heap_klass_t	klass[KLASS_MAX];
+	heap_usage_t	storage[HEAP_KINDS];
+	long long	bytes;		/* slots and storage */
+}heap_snapshot_t;
+
+const char*	heap_kind_name(int kind);
+void		heap_klass(const klass_t *klass, heap_klass_t *stats);
+void		heap_snapshot(heap_snapshot_t *s);
+/* Prints the klasses and storage kinds that changed from before to after,
+ * f may be NULL to only count them. Returns the number of those that
+ * grew. */
+int		heap_diff(FILE *f, const heap_snapshot_t *before, const heap_snapshot_t *after);
+void		heap_report(FILE *f);
+
+/* Calls visit on every live instance of klass, or on every object when
+ * klass is NULL, through obj_walk(): visit may create objects but must
+ * not free any. Returns the number of objects visited, or -1 when out of
+ * memory. */
+typedef void (*heap_visit_t)(obj_t *self, void *ctx);
+int		heap_walk(const klass_t *klass, heap_visit_t visit, void *ctx);
+
+#endif
@@ -2,35 +2,326 @@
 #include <string.h>
 #include <stdlib.h>
 #include "object.h"
+#include "atom.h"
+#include "trace.h"
+#include "gc.h"
+#include "heap.h"
 
-static unsigned int uid = 1;
+static const klass_t *klasses[KLASS_MAX];
+static int klass_count = 0;
+static sync_lock_t klass_lock = 0;
 
+static void register_klass(const klass_t *klass){
+	klass_info_t *info = klass->info;
+	const klass_t *k;
+	if(info->id){
+		return;
+	}
+	if(klass_count + 1 >= KLASS_MAX){
+		fprintf(stderr,"ERROR: klass_register(%s) : too many klasses\n",klass->name);
+		return;
+	}
+	info->vt = *klass;
+	if(klass->parent){
+		const klass_info_t *pinfo = klass->parent->info;
+		const klass_t *pvt = &pinfo->vt;
+		register_klass(klass->parent);
+		if(pinfo->depth + 1 >= KLASS_MAX_DEPTH){
+			fprintf(stderr,"ERROR: klass_register(%s) : inheritance deeper than %d\n",klass->name,KLASS_MAX_DEPTH);
+			return;
+		}
+		info->depth = pinfo->depth + 1;
+		memcpy(info->display,pinfo->display,sizeof(info->display));
+		#define INHERIT(slot) if(!info->vt.slot){ info->vt.slot = pvt->slot; }
+		INHERIT(clone)
+		INHERIT(equals)
+		INHERIT(print)
+		INHERIT(hash)
+		INHERIT(to)
+		INHERIT(get)
+		INHERIT(get_index)
+		INHERIT(set)
+		INHERIT(set_index)
+		INHERIT(append)
+		INHERIT(rem)
+		INHERIT(rem_index)
+		INHERIT(len)
+		INHERIT(iterator)
+		INHERIT(traverse)
+		#undef INHERIT
+	}
+	info->display[info->depth] = klass;
+	k = klass;
+	while(k){
+		if(k->constructor){
+			info->ctor[info->ctor_count++] = k->constructor;
+		}
+		if(k->destructor){
+			info->dtor[info->dtor_count++] = k->destructor;
+		}
+		k = k->parent;
+	}
+	slab_pool_init(&info->pool,klass->name,klass->size,1);
+	klasses[klass_count + 1] = klass;
+	SYNC_STORE(info->id,++klass_count);
+}
+void		klass_register(const klass_t *klass){
+	sync_lock(&klass_lock);
+	register_klass(klass);
+	sync_unlock(&klass_lock);
+}
+const klass_t*	klass_by_id(int id){
+	if(id > 0 && id <= klass_count){
+		return klasses[id];
+	}else{
+		return NULL;
+	}
+}
+
+#ifdef OBJ_IMMEDIATES
+static obj_t *immediate(unsigned int bits, int tag){
+	return (obj_t*)(((uintptr_t)bits << 32) | tag);
+}
+static int immediate_int(const obj_t *self){
+	return (int)(unsigned int)((uintptr_t)self >> 32);
+}
+static float immediate_float(const obj_t *self){
+	unsigned int bits = (unsigned int)((uintptr_t)self >> 32);
+	float f;
+	memcpy(&f,&bits,sizeof(float));
+	return f;
+}
+#endif
+
+/*	HANDLES		*/
+/* Every object holds a slot of the handle table from obj_alloc() to
+ * obj_free(), its uid is the whole generation of the slot on top of the
+ * slot index. Slots live in pages that are never freed nor moved, so that
+ * lookups take no lock. Freeing an object bumps the generation of its
+ * slot, which stales its uid and weak handles, and pushes the slot on
+ * the free list. The free list is a lock-free stack whose head carries a
+ * count of the pushes and pops in its high half, so that a head that was
+ * popped and pushed back meanwhile fails the compare and swap. The lock
+ * is only taken to add a page. Slot 0 is never handed out: uids are never
+ * 0 and a zeroed object owns no slot. */
+#ifndef OBJ_HANDLE_BITS
+#define OBJ_HANDLE_BITS		24
+#endif
+#if OBJ_HANDLE_BITS < 16 || OBJ_HANDLE_BITS > 28
+#error "OBJ_HANDLE_BITS must be between 16 and 28"
+#endif
+#define HANDLE_MAX		(1u << OBJ_HANDLE_BITS)
+#define HANDLE_PAGE_BITS	12
+#define HANDLE_PAGE_LENGTH	(1 << HANDLE_PAGE_BITS)
+#define HANDLE_PAGES		(HANDLE_MAX >> HANDLE_PAGE_BITS)
+
+typedef struct handle_s{
+	obj_t		*object;
+	unsigned int	generation;
+	unsigned int	next;		/* index of the next free slot */
+}handle_t;
+
+typedef struct handle_table_s{
+	unsigned int	length;		/* slots ever handed out, and slot 0 */
+	uint64_t	free;		/* tag << 32 | index of the first free slot */
+	sync_lock_t	lock;
+	handle_t	*pages[HANDLE_PAGES];
+}handle_table_t;
+
+static handle_table_t handles = {1};
+
+#define handle_slot(index) \
+	(&handles.pages[(index) >> HANDLE_PAGE_BITS][(index) & (HANDLE_PAGE_LENGTH - 1)])
+#define handle_uid(index,generation) \
+	((obj_uid_t)(generation) << 32 | (index))
+
+/* pops a free slot, returns its index or 0 when there is none */
+static unsigned int handle_pop(void){
+	uint64_t head = SYNC_LOAD(handles.free), next;
+	do{
+		unsigned int index = (unsigned int)head;
+		if(!index){
+			return 0;
+		}
+		next = ((head >> 32) + 1) << 32 | SYNC_LOAD(handle_slot(index)->next);
+	}while(!SYNC_CAS(handles.free,head,next));
+	return (unsigned int)head;
+}
+static void handle_push(unsigned int index){
+	uint64_t head = SYNC_LOAD(handles.free), next;
+	do{
+		SYNC_STORE(handle_slot(index)->next,(unsigned int)head);
+		next = ((head >> 32) + 1) << 32 | index;
+	}while(!SYNC_CAS(handles.free,head,next));
+}
+/* a slot never handed out, the page is added before the slot is claimed
+ * so that a failure leaves the table as it was */
+static unsigned int handle_fresh(void){
+	unsigned int length = SYNC_LOAD(handles.length);
+	do{
+		handle_t **page = &handles.pages[length >> HANDLE_PAGE_BITS];
+		if(length == HANDLE_MAX){
+			fprintf(stderr,"ERROR: obj_new() : %u objects are live, the most the handle table holds, see OBJ_HANDLE_BITS\n",HANDLE_MAX - 1);
+			return 0;
+		}
+		if(!SYNC_LOAD(*page)){
+			sync_lock(&handles.lock);
+			if(!*page){
+				handle_t *p = (handle_t*)calloc(HANDLE_PAGE_LENGTH,sizeof(handle_t));
+				if(!p){
+					sync_unlock(&handles.lock);
+					fprintf(stderr,"ERROR: obj_new() : out of memory for the handle table\n");
+					return 0;
+				}
+				SYNC_STORE(*page,p);
+			}
+			sync_unlock(&handles.lock);
+		}
+	}while(!SYNC_CAS(handles.length,length,length + 1));
+	return length;
+}
+/* gives ob a slot, returns 0 when out of memory or slots */
+static int handle_alloc(object_t *ob){
+	unsigned int index = handle_pop();
+	if(!index && !(index = handle_fresh())){
+		return 0;
+	}
+	ob->handle = index;
+	SYNC_STORE(handle_slot(index)->object,ob);
+	return 1;
+}
+static void handle_free(object_t *ob){
+	handle_t *slot = handle_slot(ob->handle);
+	SYNC_STORE(slot->generation,slot->generation + 1);
+	SYNC_STORE(slot->object,NULL);
+	handle_push(ob->handle);
+}
+/* the object of slot index while its generation matches */
+static obj_t *handle_get(unsigned int index, unsigned int generation){
+	const handle_t *page;
+	const handle_t *slot;
+	obj_t *self;
+	if(index >= SYNC_LOAD(handles.length) || !(page = SYNC_LOAD(handles.pages[index >> HANDLE_PAGE_BITS]))){
+		return NULL;
+	}
+	slot = &page[index & (HANDLE_PAGE_LENGTH - 1)];
+	if(SYNC_LOAD(slot->generation) != generation){
+		return NULL;
+	}
+	self = SYNC_LOAD(slot->object);
+	/* the object may have died between the two loads */
+	return SYNC_LOAD(slot->generation) == generation ? self : NULL;
+}
+/* whether the slab slot at ob holds a live object: its slot in the table
+ * points back at it. Freed slots keep a stale index and any other bytes
+ * of a slab make an index that points elsewhere or nowhere. */
+static int handle_owns(const object_t *ob){
+	unsigned int index = ob->handle;
+	const handle_t *page;
+	if(index >= SYNC_LOAD(handles.length) || !(page = SYNC_LOAD(handles.pages[index >> HANDLE_PAGE_BITS]))){
+		return 0;
+	}
+	return SYNC_LOAD(page[index & (HANDLE_PAGE_LENGTH - 1)].object) == (const obj_t*)ob;
+}
+obj_t*		obj_by_uid(obj_uid_t uid){
+	return handle_get((unsigned int)uid,(unsigned int)(uid >> 32));
+}
+typedef struct walk_s{
+	void	(*visit)(obj_t *self, void *ctx);
+	void	*ctx;
+	int	count;
+}walk_t;
+
+/* arena slabs mix slot sizes, they are probed at every grain a slot may
+ * start on */
+static void walk_slab(char *slots, int used, int slot_size, void *ctx){
+	walk_t *w = (walk_t*)ctx;
+	int step = slot_size ? slot_size : SLAB_GRAIN;
+	int offset;
+	for(offset = 0; offset + (int)sizeof(object_t) <= used; offset += step){
+		object_t *ob = (object_t*)(slots + offset);
+		if(handle_owns(ob)){
+			w->visit((obj_t*)ob,w->ctx);
+			w->count++;
+		}
+	}
+}
+int		obj_walk(void (*visit)(obj_t *self, void *ctx), void *ctx){
+	const klass_t *klass;
+	walk_t w;
+	int id;
+	w.visit = visit;
+	w.ctx = ctx;
+	w.count = 0;
+	for(id = 1; (klass = klass_by_id(id)); id++){
+		if(slab_walk(&klass->info->pool,walk_slab,&w) < 0){
+			return -1;
+		}
+	}
+	return slab_walk(NULL,walk_slab,&w) < 0 ? -1 : w.count;
+}
+
+/* a zeroed instance with a uid and one reference, the klass is registered */
+static object_t *obj_alloc(const klass_t *klass){
+	object_t *ob = (object_t*)slab_alloc(&klass->info->pool);
+	if(ob){
+		memset(ob,0,klass->size);
+		ob->klass = klass;
+		ob->refcount = 1;
+		if(!handle_alloc(ob)){
+			slab_free(&klass->info->pool,ob);
+			return NULL;
+		}
+		TRACE_ALLOC(klass->info->id,obj_uid((obj_t*)ob));
+	}
+	return ob;
+}
 obj_t*		obj_new(const klass_t *klass, ... ){
-	object_t * ob = (object_t*)malloc(klass->size);
+	klass_info_t *info = klass->info;
+	object_t * ob;
+	if(!SYNC_LOAD(info->id)){
+		klass_register(klass);
+	}
+#ifdef OBJ_IMMEDIATES
+	if(klass == Int || klass == Float){
+		va_list ap;
+		unsigned int bits;
+		va_start(ap,klass);
+		if(klass == Int){
+			bits = (unsigned int)va_arg(ap,int);
+		}else{
+			float f = (float)va_arg(ap,double);
+			memcpy(&bits,&f,sizeof(float));
+		}
+		va_end(ap);
+		return immediate(bits,klass == Int ? OBJ_TAG_INT : OBJ_TAG_FLOAT);
+	}
+#endif
+	ob = obj_alloc(klass);
 	if(!ob){
 		fprintf(stderr,"ERROR: obj_new(%s,...) out of memory\n",klass->name);
 		return NULL;
 	}else{
-		memset(ob,0,klass->size);
-		ob->klass = klass;
-		ob->uid = uid++;
-		ob->refcount = 1;
-		snprintf(ob->name,NAME_LENGTH,"%s%d",klass->name,ob->uid);
-		while(klass){
-			if(klass->constructor){	
-				va_list ap;
-				va_start(ap,klass);
-				klass->constructor(ob,&ap);
-			}
-			klass = klass->parent;
+		int i;
+		for(i = 0; i < info->ctor_count; i++){
+			va_list ap;
+			va_start(ap,klass);
+			info->ctor[i](ob,&ap);
+			va_end(ap);
 		}
 		return ob;
 	}	
 }
 obj_t *obj_ref(obj_t *_self){
 	object_t *self = (object_t*)_self; 
-	if(self){
-		self->refcount++;
+	if(obj_is_immediate(_self)){
+		return _self;
+	}else if(self){
+		if(self->flags & OBJ_LOCAL){
+			self->refcount++;
+		}else{
+			SYNC_INC(self->refcount);
+		}
 	}else{
 		fprintf(stderr,"ERROR: obj_ref() : referencing NULL object)\n");
 	}
@@ -38,9 +329,13 @@ obj_t *obj_ref(obj_t *_self){
 }
 obj_t *obj_unref(obj_t *_self){
 	object_t *self = (object_t*)_self; 
-	if(self){
-		self->refcount--;
-		if(self->refcount > 0){
+	if(obj_is_immediate(_self)){
+		return _self;
+	}else if(self){
+		int count;
+		GC_UNREF(_self);
+		count = (self->flags & OBJ_LOCAL) ? --self->refcount : SYNC_DEC(self->refcount);
+		if(count > 0){
 			return _self;
 		}else{
 			obj_free(self);
@@ -50,352 +345,1114 @@ obj_t *obj_unref(obj_t *_self){
 		return NULL;
 	}
 }
+
+/* The pools of a thread share one buffer, each pool owns the objects
+ * added since it was pushed. */
+typedef struct pool_mark_s{
+	int	start;
+	int	arena;
+}pool_mark_t;
+
+typedef struct pool_stack_s{
+	obj_t		**item;
+	int		length;
+	int		capacity;
+	pool_mark_t	*mark;
+	int		depth;
+	int		mark_capacity;
+}pool_stack_t;
+
+static THREAD_LOCAL pool_stack_t pools;
+
+static void pool_push(int arena){
+	if(pools.depth == pools.mark_capacity){
+		int capacity = pools.mark_capacity ? pools.mark_capacity*2 : 8;
+		pool_mark_t *m = (pool_mark_t*)realloc(pools.mark,capacity*sizeof(pool_mark_t));
+		if(!m){
+			fprintf(stderr,"ERROR: obj_pool_push() out of memory\n");
+			return;
+		}
+		pools.mark = m;
+		pools.mark_capacity = capacity;
+	}
+	pools.mark[pools.depth].start = pools.length;
+	pools.mark[pools.depth].arena = arena;
+	pools.depth++;
+	if(arena){
+		slab_arena_begin();
+	}
+}
+void		obj_pool_push(void){
+	pool_push(0);
+}
+void		obj_pool_push_arena(void){
+	pool_push(1);
+}
+/* releasing an object may autorelease others, they are released too */
+void		obj_pool_pop(void){
+	pool_mark_t m;
+	if(!pools.depth){
+		fprintf(stderr,"ERROR: obj_pool_pop() : no pool is open\n");
+		return;
+	}
+	m = pools.mark[pools.depth - 1];
+	while(pools.length > m.start){
+		obj_unref(pools.item[--pools.length]);
+	}
+	pools.depth--;
+	if(m.arena){
+		slab_arena_end();
+	}
+}
+obj_t*		obj_autorelease(obj_t *self){
+	if(!self || obj_is_immediate(self)){
+		return self;
+	}else if(!pools.depth){
+		fprintf(stderr,"ERROR: obj_autorelease() : no pool is open for %s\n",obj_name(self));
+		return self;
+	}
+	if(pools.length == pools.capacity){
+		int capacity = pools.capacity ? pools.capacity*2 : 64;
+		obj_t **item = (obj_t**)realloc(pools.item,capacity*sizeof(obj_t*));
+		if(!item){
+			fprintf(stderr,"ERROR: obj_autorelease() out of memory\n");
+			return self;
+		}
+		pools.item = item;
+		pools.capacity = capacity;
+	}
+	pools.item[pools.length++] = self;
+	return self;
+}
 obj_t *tmp(obj_t *_self){
 	object_t *self = (object_t*)_self; 
-	self->refcount--;
+	if(!_self || obj_is_immediate(_self)){
+		return _self;
+	}else if(pools.depth){
+		return obj_autorelease(_self);
+	}
+	SYNC_DEC(self->refcount);
 	return _self;
 }
+obj_t*		obj_box(obj_t *box, const char *fn){
+	if(!box || obj_is_immediate(box)){
+		return box;
+	}else if(!pools.depth){
+		fprintf(stderr,"ERROR: %s() : boxing %s needs an open pool, see obj_pool_push()\n",fn,obj_name(box));
+		obj_unref(box);
+		return NULL;
+	}
+	return obj_autorelease(box);
+}
+void		obj_set_local(obj_t *self){
+	if(!obj_is_immediate(self)){
+		SYNC_OR(obj(self)->flags,OBJ_LOCAL);
+	}
+}
+obj_t*		obj_share(obj_t *self){
+	if(!obj_is_immediate(self) && (obj(self)->flags & OBJ_LOCAL)){
+		SYNC_AND(obj(self)->flags,~OBJ_LOCAL);
+		SYNC_FENCE();
+	}
+	return self;
+}
 
 void  		obj_free(obj_t *self){
-	object_t *o = (object_t*)self;
-	const klass_t  *k = o->klass;
-	while(k && o){
-		if(k->destructor){
-			o = k->destructor(o);
-		}
-		if(o){
-			k = k->parent;
-		}
+	const klass_info_t *info;
+	obj_t *o = self;
+	int i;
+	if(obj_is_immediate(self)){
+		return;
+	}
+	info = obj(self)->klass->info;
+	TRACE_FREE(info->id,obj_uid(self));
+	GC_FORGET(self);
+	handle_free(obj(self));
+	for(i = 0; o && i < info->dtor_count; i++){
+		o = info->dtor[i](o);
 	}
 }
-obj_t*		obj_clone(const obj_t *self);	/*TODO*/
+void		obj_arena_begin(void){
+	slab_arena_begin();
+}
+void		obj_arena_end(void){
+	slab_arena_end();
+}
+void		obj_alloc_report(FILE *f){
+	slab_report(f);
+}
+const slab_pool_t* obj_alloc_stats(const klass_t *klass){
+	return &klass->info->pool;
+}
 int    		obj_equals(const obj_t *self, const obj_t *b){
 	if(self == b){
 		return 1;
-	}else if(obj(self)->klass != obj(b)->klass){
+	}else if(!self || !b || obj_klass(self) != obj_klass(b)){
 		return 0;
-	}else{
-		const klass_t *k = obj(self)->klass;
-		while(k && !k->equals){
-			k = k->parent;
-		}
-		if(k){
-			return k->equals(self,b);
-		}
+	}else if(obj_vt(self)->equals){
+		return obj_vt(self)->equals(self,b);
 	}
 	return 0;
 }
-void   		obj_printf(FILE*f, const obj_t *_self){
+void		obj_write(writer_t *w, const obj_t *_self){
 	if(!_self){
-		fprintf(f,"NULL");
+		writer_bytes(w,"NULL",4);
 	}else{
-		const object_t *self = (object_t*)_self;
-		const klass_t *k = self->klass;
-		while(k && !k->print){
-			k = k->parent;
-		}
-		if(k && k->print){
-			k->print(_self,f);
+		const klass_t *vt = obj_vt(_self);
+		if(vt->print){
+			vt->print(_self,w);
 		}else{
-			fprintf(f,"UNPRINTABLE_%s",self->name);
+			writer_string(w,"UNPRINTABLE_");
+			writer_string(w,obj_name(_self));
 		}
 	}
 }
+void   		obj_printf(FILE*f, const obj_t *_self){
+	writer_t w;
+	writer_init(&w,f);
+	obj_write(&w,_self);
+	writer_free(&w);
+}
 void   		obj_printfn(FILE*f, const obj_t *_self){
-	obj_printf(f,_self);
-	fprintf(f,"\n");
+	writer_t w;
+	writer_init(&w,f);
+	obj_write(&w,_self);
+	writer_char(&w,'\n');
+	writer_free(&w);
+}
+char*		obj_to_buffer(const obj_t *_self, size_t *length){
+	writer_t w;
+	char *text;
+	writer_init(&w,NULL);
+	obj_write(&w,_self);
+	text = writer_detach(&w,length);
+	writer_free(&w);
+	return text;
 }
 unsigned int 	obj_hash(const obj_t *self){
-	const klass_t *k = obj(self)->klass;
-	while(k && !k->hash){
-		k = k->parent;
-	}
-	if(k){
-		return k->hash(self);
+	const klass_t *vt = obj_vt(self);
+	if(vt->hash){
+		return vt->hash(self);
 	}else{
-		return obj(self)->uid;
+		return (unsigned int)obj_uid(self);
 	}
 }
-int		obj_instance_of(obj_t *self, const klass_t *ki){
-	const klass_t *k = obj(self)->klass;
-	while(k){
-		if(k == ki){
-			return 1;
-		}else{
-			k = k->parent;
+
+/*	CONTAINER HASHING	*/
+#define hash_invalidate(x)	SYNC_AND(obj(x)->flags,~OBJ_HASHED)
+#define hash_cached(x)		(SYNC_LOAD(obj(x)->flags) & OBJ_HASHED)
+
+/* Int, Float and String never change, a hash built from them stays valid */
+static int hash_is_leaf(const obj_t *o){
+	return !o || obj_is_immediate(o) || obj_instance_of((obj_t*)o,Int)
+		|| obj_instance_of((obj_t*)o,Float) || obj_instance_of((obj_t*)o,String);
+}
+static unsigned int hash_element(const obj_t *o){
+	return o ? obj_hash(o) : 0x6b43a9b5u;
+}
+static unsigned int hash_store(const obj_t *self, unsigned int *cache, unsigned int h, int leaves){
+	if(leaves){
+		*cache = h;
+		SYNC_FENCE();
+		SYNC_OR(obj(self)->flags,OBJ_HASHED);
+	}
+	return h;
+}
+/* both hashes are known and differ */
+static int hash_differs(const obj_t *a, unsigned int ha, const obj_t *b, unsigned int hb){
+	return hash_cached(a) && hash_cached(b) && ha != hb;
+}
+static unsigned int sequence_hash(const obj_t *self, int *leaves){
+	unsigned int h = obj_hash_combine(0x2545f491u,obj_len(self));
+	obj_iter_t it;
+	const void *span;
+	int n, i;
+	*leaves = 1;
+	obj_iterator(self,&it);
+	while((n = obj_iter_next_n(&it,&span,4096)) > 0){
+		obj_t * const *refs = (obj_t * const*)span;
+		for(i = 0; i < n; i++){
+			h = obj_hash_combine(h,hash_element(refs[i]));
+			*leaves = *leaves && hash_is_leaf(refs[i]);
 		}
 	}
-	return 0;
+	return obj_hash_finish(h);
 }
-
-/*	OBJECT FIELDS		*/
-static unsigned int hash_string(const char *str, int str_len){
-	unsigned int hash = 5381;
-	int i = str_len;
-	while(i--){
-		hash = (hash << 5) + hash + str[i];
+static int sequence_equals(const obj_t *a, const obj_t *b){
+	obj_iter_t ia, ib;
+	obj_t *x, *y;
+	if(obj_len(a) != obj_len(b)){
+		return 0;
 	}
-	return hash;
-}
-static field_t *new_field(obj_t *object, const char *key){
-	field_t *f = malloc(sizeof(field_t));
-	if(!f){
-		fprintf(stderr,"ERROR: obj_set_field(...) -> new_field(...) out of memory\n");
-	}else{
-		f->key  = malloc(sizeof(strlen(key)));
-		if(!f->key){
-			fprintf(stderr,"ERROR: obj_set_field(...) -> new_field(...) out of memory\n");
-			free(f);
-			return NULL;
-		}else{
-			strcpy(f->key,key);
+	obj_iterator(a,&ia);
+	obj_iterator(b,&ib);
+	while(obj_iter_next(&ia,&x) && obj_iter_next(&ib,&y)){
+		if(!obj_equals(x,y)){
+			return 0;
 		}
-		f->hash = hash_string(key,strlen(key));
-		f->data = object;
-		f->next = NULL;
 	}
-	return f;
+	return 1;
+}
+int		obj_instance_of(obj_t *self, const klass_t *ki){
+	const klass_info_t *info = obj_klass(self)->info;
+	if(!SYNC_LOAD(ki->info->id)){
+		klass_register(ki);
+	}
+	return ki->info->depth <= info->depth && info->display[ki->info->depth] == ki;
 }
-static void free_field(field_t *field){
-	free(field->key);
-	free(field);
+
+/* Storage shared by clones is hidden from the cycle collector. When it is
+ * left with one owner its elements are recorded as possible roots, so
+ * that cycles through it are found again. */
+static void gc_unshared(obj_t * const *data, int count){
+#ifdef OBJ_GC
+	int i;
+	for(i = 0; i < count; i++){
+		if(data[i] && !obj_is_immediate(data[i])){
+			GC_POSSIBLE_ROOT(data[i]);
+		}
+	}
+#endif
 }
-static fieldtable_t *new_fieldtable(void){
-	fieldtable_t *ft = malloc(sizeof(fieldtable_t));
+
+/*	OBJECT FIELDS		*/
+#define FIELDTABLE_SIZE(length) (sizeof(fieldtable_t) + (length)*sizeof(field_t))
+
+static fieldtable_t *new_fieldtable(int length){
+	fieldtable_t *ft = malloc(FIELDTABLE_SIZE(length));
 	if(!ft){
 		fprintf(stderr,"ERROR: obj_set_field(...) -> new_fieldtable() out of memory\n");
 	}else{
-		ft->table_length = 2;
+		HEAP_ALLOC(HEAP_FIELDS,FIELDTABLE_SIZE(length));
+		ft->table_length = length;
 		ft->field_count  = 0;
-		ft->table  = malloc(ft->table_length*sizeof(field_t*));
-		if(!ft->table){
-			fprintf(stderr,"ERROR: obj_set_field(...) -> new_fieldtable() out of memory\n");
-			free(ft);
-			return NULL;
-		}else{
-			memset(ft->table,0,ft->table_length*sizeof(field_t*));
-		}
+		ft->owners = 1;
+		memset(ft->table,0,length*sizeof(field_t));
 	}
 	return ft;
 }
-static obj_t *fieldtable_insert(fieldtable_t*ft, obj_t *object, const char *key){
-	field_t *f = new_field(object,key);
-	int index =  f->hash % ft->table_length;
-	if(!ft->table[index]){
-		ft->table[index] = f;
-		ft->field_count  += 1;
-		return NULL;
-	}else{
-		field_t *c = ft->table[index];
-		while(c){
-			if(f->hash == c->hash && !strcmp(f->key,c->key)){
-				obj_t * old = c->data;
-				c->data = f->data;
-				free_field(f);
-				return old;
-			}else if(c->next){
-				c = c->next;
-			}else{
-				c->next = f;
-				ft->field_count +=1;
-				break;
-			}
+/* drops one owner of the table, the last one releases the fields */
+static void free_fieldtable(fieldtable_t *ft){
+	int i = ft->table_length;
+	int owners = SYNC_DEC(ft->owners);
+	if(owners){
+		while(owners == 1 && i--){
+			gc_unshared(&ft->table[i].data,1);
 		}
-		return NULL;
+		return;
 	}
+	while(i--){
+		if(ft->table[i].key){
+			obj_unref(ft->table[i].data);
+		}
+	}
+	HEAP_FREE(HEAP_FIELDS,FIELDTABLE_SIZE(ft->table_length));
+	free(ft);
 }
-static obj_t *fieldtable_get(const fieldtable_t *ft,const char *key){
-	unsigned int hash = hash_string(key,strlen(key));
-	int index = hash % ft->table_length;
-	field_t *f = ft->table[index];
-	while(f){
-		if(f->hash == hash && !strcmp(f->key,key)){
-			return f->data;
-		}else{
-			f = f->next;
+/* distance of the field in slot i from the slot its hash points to */
+#define PROBE_DIST(ft,i) (((i) - (ft)->table[i].hash) & ((ft)->table_length - 1))
+
+/* Robin Hood insertion of a key that is not in the table: a field that
+ * is closer to its home slot than the one being placed gives its slot
+ * up and is pushed further. */
+static void fieldtable_place(fieldtable_t *ft, field_t f){
+	unsigned int mask = ft->table_length - 1;
+	unsigned int i = f.hash & mask;
+	unsigned int dist = 0;
+	while(ft->table[i].key){
+		unsigned int d = PROBE_DIST(ft,i);
+		if(d < dist){
+			field_t t = ft->table[i];
+			ft->table[i] = f;
+			f = t;
+			dist = d;
+		}
+		i = (i + 1) & mask;
+		dist++;
+	}
+	ft->table[i] = f;
+	ft->field_count++;
+}
+static int fieldtable_find(const fieldtable_t *ft, const atom_t *key){
+	unsigned int mask = ft->table_length - 1;
+	unsigned int i = key->hash & mask;
+	unsigned int dist = 0;
+	while(ft->table[i].key && PROBE_DIST(ft,i) >= dist){
+		if(ft->table[i].key == key){
+			return i;
+		}
+		i = (i + 1) & mask;
+		dist++;
+	}
+	return -1;
+}
+static fieldtable_t *fieldtable_resize(fieldtable_t *ft, int length){
+	fieldtable_t *nft = new_fieldtable(length);
+	int i = ft->table_length;
+	if(!nft){
+		return ft;
+	}
+	while(i--){
+		if(ft->table[i].key){
+			fieldtable_place(nft,ft->table[i]);
 		}
 	}
+	HEAP_FREE(HEAP_FIELDS,FIELDTABLE_SIZE(ft->table_length));
+	free(ft);
+	return nft;
+}
+static obj_t *fieldtable_insert(fieldtable_t **_ft, obj_t *object, const atom_t *key){
+	fieldtable_t *ft = *_ft;
+	int i = fieldtable_find(ft,key);
+	field_t f;
+	if(i >= 0){
+		obj_t *old = ft->table[i].data;
+		ft->table[i].data = object;
+		return old;
+	}
+	f.hash = key->hash;
+	f.key  = key;
+	f.data = object;
+	if((ft->field_count + 1)*4 > ft->table_length*3){
+		*_ft = ft = fieldtable_resize(ft,ft->table_length*2);
+	}
+	fieldtable_place(ft,f);
 	return NULL;
 }
-static obj_t *fieldtable_remove(fieldtable_t *ft, const char *key){
-	unsigned int hash = hash_string(key,strlen(key));
-	int index = hash % ft->table_length;
-	field_t *f = ft->table[index];
-	if(!f){
-		return NULL;
-	}else if(f->hash == hash && !strcmp(f->key,key)){
-		obj_t *ret = f->data;
-		ft->table[index] = f->next;
-		free_field(f);
-		ft->field_count--;
-		return ret;
+static obj_t *fieldtable_get(const fieldtable_t *ft,const atom_t *key){
+	int i = fieldtable_find(ft,key);
+	if(i >= 0){
+		return ft->table[i].data;
 	}else{
-		field_t *pred = f;
-		f = f->next;
-		while(f){
-			if(f->hash == hash && !strcmp(f->key,key)){
-				obj_t *ret   = f->data;
-				pred->next = f->next;
-				free_field(f);
-				ft->field_count--;
-				return ret;
-			}else{
-				pred = f;
-				f = f->next;
-			}
-		}
 		return NULL;
 	}
 }
-void	obj_set_field(obj_t *_self, const char *field, obj_t *value){
+/* Removal shifts the following fields of the probe run back by one slot
+ * instead of leaving a tombstone. */
+static obj_t *fieldtable_remove(fieldtable_t *ft, const atom_t *key){
+	unsigned int mask = ft->table_length - 1;
+	int i = fieldtable_find(ft,key);
+	unsigned int j;
+	obj_t *ret;
+	if(i < 0){
+		return NULL;
+	}
+	ret = ft->table[i].data;
+	j = (i + 1) & mask;
+	while(ft->table[j].key && PROBE_DIST(ft,j)){
+		ft->table[i] = ft->table[j];
+		i = j;
+		j = (j + 1) & mask;
+	}
+	memset(&ft->table[i],0,sizeof(field_t));
+	ft->field_count--;
+	return ret;
+}
+/* gives a cloned object a table of its own before it is written to,
+ * returns 0 when out of memory */
+static int fieldtable_own(object_t *self){
+	fieldtable_t *ft = self->field, *nft;
+	size_t size;
+	int i;
+	if(!ft || SYNC_LOAD(ft->owners) == 1){
+		return 1;
+	}
+	size = FIELDTABLE_SIZE(ft->table_length);
+	nft = malloc(size);
+	if(!nft){
+		fprintf(stderr,"ERROR: obj_set_field(...) -> fieldtable_own() out of memory\n");
+		return 0;
+	}
+	HEAP_ALLOC(HEAP_FIELDS,size);
+	memcpy(nft,ft,size);
+	nft->owners = 1;
+	for(i = 0; i < nft->table_length; i++){
+		if(nft->table[i].key){
+			obj_ref(nft->table[i].data);
+		}
+	}
+	free_fieldtable(ft);
+	self->field = nft;
+	return 1;
+}
+void	obj_set_field_atom(obj_t *_self, const atom_t *field, obj_t *value){
 	object_t *self = (object_t*)_self;
+	if(obj_is_immediate(_self)){
+		fprintf(stderr,"ERROR: obj_set_field() : %s values have no fields\n",obj_klass(_self)->name);
+		return;
+	}
+	if(!fieldtable_own(self)){
+		return;
+	}
+	hash_invalidate(self);
 	if(value){
 		obj_ref(value);
 		if(!self->field){
-			self->field = new_fieldtable();
+			self->field = new_fieldtable(FIELDTABLE_MIN);
+			if(!self->field){
+				obj_unref(value);
+				return;
+			}
 		}
-		obj_unref(fieldtable_insert(self->field,value,field));
+		obj_unref(fieldtable_insert(&self->field,value,field));
 	}else{
 		if(self->field){
 			obj_unref(fieldtable_remove(self->field,field));
 		}
 	}
 }
-obj_t*		obj_get_field(const obj_t *_self, const char *field){
+obj_t*		obj_get_field_atom(const obj_t *_self, const atom_t *field){
 	const object_t *self = (object_t*)_self;
-	if(self->field){
+	if(!obj_is_immediate(_self) && self->field){
 		return fieldtable_get(self->field,field);
 	}else{
 		return NULL;
 	}
 }
+void	obj_set_field(obj_t *_self, const char *field, obj_t *value){
+	const atom_t *key = value ? atom(field) : atom_find(field);
+	if(key){
+		obj_set_field_atom(_self,key,value);
+	}
+}
+obj_t*		obj_get_field(const obj_t *_self, const char *field){
+	const atom_t *key;
+	if(obj_is_immediate(_self) || !obj(_self)->field || !(key = atom_find(field))){
+		return NULL;
+	}
+	return fieldtable_get(obj(_self)->field,key);
+}
+/*	CLONES		*/
+obj_t*		obj_copy(const obj_t *_self){
+	const klass_t *klass;
+	object_t *c;
+	if(!_self || obj_is_immediate(_self)){
+		return (obj_t*)_self;
+	}
+	klass = obj_klass(_self);
+	c = obj_alloc(klass);
+	if(!c){
+		fprintf(stderr,"ERROR: obj_clone(%s) out of memory\n",obj_name(_self));
+		return NULL;
+	}
+	memcpy(c + 1,obj(_self) + 1,klass->size - sizeof(object_t));
+	c->field = obj(_self)->field;
+	if(c->field){
+		SYNC_INC(c->field->owners);
+	}
+	return c;
+}
+obj_t*		obj_clone(const obj_t *self){
+	const klass_t *vt;
+	if(!self || obj_is_immediate(self)){
+		return (obj_t*)self;
+	}
+	vt = obj_vt(self);
+	return vt->clone ? vt->clone((obj_t*)self) : obj_copy(self);
+}
+
+/*	PATHS		*/
+static int path_segment(const char *path, int start){
+	int i = start;
+	while(path[i] && path[i] != '/'){
+		i++;
+	}
+	return i - start;
+}
 obj_t*	obj_get(const obj_t *self, const char *path){
-	char 	curr_name[64];
-	int  	curr_index = 0;
 	const obj_t* curr_obj = self;
+	int curr_index = 0;
 	while(1){
-		int i = 0;
-		memset(curr_name,0,64);
-		while(path[curr_index + i] && path[curr_index + i]!='/'){
-			curr_name[i] = path[curr_index + i];
-			i++;
+		int len = path_segment(path,curr_index);
+		const atom_t *key;
+		if(len == 0){
+			fprintf(stderr,"ERROR: obj_get() : path badly formated : '%s'\n",path);
+			return NULL;
 		}
-		if(i == 0){
-			fprintf(stderr,"ERROR: obj_path() : path badly formated : '%s'\n",path);
+		key = atom_find_len(path + curr_index,len);
+		curr_obj = key ? obj_get_field_atom(curr_obj,key) : NULL;
+		if(!curr_obj){
+			fprintf(stderr,"ERROR: obj_get(): '%.*s' not found in '%s'\n",len,path + curr_index,path);
 			return NULL;
-		}else{
-			curr_index = curr_index + i +1;
-			curr_obj = obj_get_field(curr_obj,curr_name);
-			if(!curr_obj){
-				fprintf(stderr,"ERROR: obj_path(): '%s' not found in '%s'\n",curr_name,path);
-				return NULL;
-			}else if(!path[curr_index-1]){
-				return curr_obj;
+		}else if(!path[curr_index + len]){
+			return (obj_t*)curr_obj;
+		}
+		curr_index += len + 1;
+	}
+}
+void	obj_set(obj_t *self, const char *path, obj_t *data){
+	obj_t *curr_obj = self;
+	int curr_index = 0;
+	while(1){
+		int len = path_segment(path,curr_index);
+		const atom_t *key;
+		if(len == 0){
+			fprintf(stderr,"ERROR: obj_set() : path badly formated : '%s'\n",path);
+			return;
+		}else if(!path[curr_index + len]){
+			key = data ? atom_len(path + curr_index,len) : atom_find_len(path + curr_index,len);
+			if(key){
+				obj_set_field_atom(curr_obj,key,data);
 			}
+			return;
+		}
+		key = atom_find_len(path + curr_index,len);
+		curr_obj = key ? obj_get_field_atom(curr_obj,key) : NULL;
+		if(!curr_obj){
+			fprintf(stderr,"ERROR: obj_set(): '%.*s' not found in '%s'\n",len,path + curr_index,path);
+			return;
 		}
+		curr_index += len + 1;
 	}
-	return NULL;
 }
-obj_t*		obj_get_index(const obj_t *self,int index){
-	const klass_t *k = obj(self)->klass;
-	while(k && !k->get_index){
-		k = k->parent;
+obj_path_t*	obj_path_compile(const char *path){
+	obj_path_t *p;
+	int count = 1;
+	int i, start = 0;
+	for(i = 0; path[i]; i++){
+		if(path[i] == '/'){
+			count++;
+		}
 	}
-	if(k){
-		return k->get_index(self,index);
-	}else{
-		fprintf(stderr,"ERROR: obj_get_index() : Object %s has no get_index() method\n",obj(self)->name);
+	p = malloc(sizeof(obj_path_t) + count*sizeof(obj_path_segment_t));
+	if(!p){
+		fprintf(stderr,"ERROR: obj_path_compile() out of memory\n");
 		return NULL;
 	}
-}
-void		obj_set_index(obj_t *self,int index, obj_t* data){
-	const klass_t *k = obj(self)->klass;
-	while(k && !k->set_index){
-		k = k->parent;
+	p->length = count;
+	for(i = 0; i < count; i++){
+		int len = path_segment(path,start);
+		if(len == 0){
+			fprintf(stderr,"ERROR: obj_path_compile() : path badly formated : '%s'\n",path);
+			free(p);
+			return NULL;
+		}
+		p->segment[i].key   = atom_len(path + start,len);
+		p->segment[i].table = NULL;
+		p->segment[i].slot  = 0;
+		if(!p->segment[i].key){
+			free(p);
+			return NULL;
+		}
+		start += len + 1;
 	}
-	if(k){
-		k->set_index(self,index,data);
-	}else{
-		fprintf(stderr,"ERROR: obj_set_index() : Object %s has no set_index() method\n",obj(self)->name);
+	return p;
+}
+void	obj_path_free(obj_path_t *path){
+	free(path);
+}
+obj_t*	obj_path_get(const obj_t *self, const obj_path_t *path){
+	int i;
+	for(i = 0; self && i < path->length; i++){
+		self = obj_get_field_atom(self,path->segment[i].key);
 	}
+	return (obj_t*)self;
 }
-void		obj_append_index(obj_t *self, obj_t* data){
-	const klass_t *k = obj(self)->klass;
-	while(k && !k->append){
-		k = k->parent;
+void	obj_path_set(obj_t *self, const obj_path_t *path, obj_t *data){
+	int i;
+	for(i = 0; self && i < path->length - 1; i++){
+		self = obj_get_field_atom(self,path->segment[i].key);
 	}
-	if(k){
-		k->append(self,data);
-	}else{
-		fprintf(stderr,"ERROR: obj_append() : Object %s has no append() method\n",obj(self)->name);
+	if(self){
+		obj_set_field_atom(self,path->segment[path->length - 1].key,data);
 	}
 }
-void		obj_rem_index(obj_t *self, int index){
-	const klass_t *k = obj(self)->klass;
-	while(k && !k->rem_index){
-		k = k->parent;
+/* Each segment remembers the field table and slot it was last found in.
+ * A slot that still holds the segment key is the right one, whatever
+ * happened to the table in between, so the cache needs no invalidation. */
+static const field_t *path_cached_field(const object_t *self, obj_path_segment_t *seg){
+	const fieldtable_t *ft = obj_is_immediate(self) ? NULL : self->field;
+	int i;
+	if(!ft){
+		return NULL;
+	}else if(seg->table == ft && seg->slot < ft->table_length && ft->table[seg->slot].key == seg->key){
+		return &ft->table[seg->slot];
 	}
-	if(k){
-		k->rem_index(self,index);
-	}else{
-		fprintf(stderr,"ERROR: obj_rem_index() : Object %s has no rem_index() method\n",obj(self)->name);
+	i = fieldtable_find(ft,seg->key);
+	if(i < 0){
+		return NULL;
 	}
-}
-obj_t*		obj_iterator(obj_t *self){
-	const klass_t *k = obj(self)->klass;
-	while(k && !k->iterator){
-		k = k->parent;
+	seg->table = ft;
+	seg->slot  = i;
+	return &ft->table[i];
+}
+obj_t*	obj_path_get_cached(const obj_t *self, obj_path_t *path){
+	int i;
+	for(i = 0; self && i < path->length; i++){
+		const field_t *f = path_cached_field(obj(self),&path->segment[i]);
+		self = f ? f->data : NULL;
+	}
+	return (obj_t*)self;
+}
+void	obj_path_set_cached(obj_t *self, obj_path_t *path, obj_t *data){
+	obj_path_segment_t *last = &path->segment[path->length - 1];
+	field_t *f;
+	int i;
+	for(i = 0; self && i < path->length - 1; i++){
+		f = (field_t*)path_cached_field(obj(self),&path->segment[i]);
+		self = f ? f->data : NULL;
+	}
+	if(!self){
+		return;
+	}
+	if(!obj_is_immediate(self) && !fieldtable_own(obj(self))){
+		return;
 	}
-	if(k){
-		return k->iterator(self);
+	f = (field_t*)path_cached_field(obj(self),last);
+	if(f && data){
+		obj_t *old = f->data;
+		hash_invalidate(self);
+		f->data = obj_ref(data);
+		obj_unref(old);
 	}else{
-		fprintf(stderr,"ERROR: obj_iterator() : Object %s has no iterator() method\n",obj(self)->name);
-		return NULL;
+		obj_set_field_atom(self,last->key,data);
+	}
+}
+obj_t*		obj_get_index(const obj_t *self,int index){
+	const klass_t *vt = obj_vt(self);
+	if(vt->get_index){
+		return vt->get_index(self,index);
+	}else{
+		fprintf(stderr,"ERROR: obj_get_index() : Object %s has no get_index() method\n",obj_name(self));
+		return NULL;
+	}
+}
+void		obj_set_index(obj_t *self,int index, obj_t* data){
+	const klass_t *vt = obj_vt(self);
+	if(vt->set_index){
+		vt->set_index(self,index,data);
+	}else{
+		fprintf(stderr,"ERROR: obj_set_index() : Object %s has no set_index() method\n",obj_name(self));
+	}
+}
+void		obj_append(obj_t *self, obj_t* data){
+	const klass_t *vt = obj_vt(self);
+	if(vt->append){
+		vt->append(self,data);
+	}else{
+		fprintf(stderr,"ERROR: obj_append() : Object %s has no append() method\n",obj_name(self));
+	}
+}
+void		obj_rem_index(obj_t *self, int index){
+	const klass_t *vt = obj_vt(self);
+	if(vt->rem_index){
+		vt->rem_index(self,index);
+	}else{
+		fprintf(stderr,"ERROR: obj_rem_index() : Object %s has no rem_index() method\n",obj_name(self));
 	}
 }
 obj_t*		obj_to(const obj_t *self,const klass_t *klass){
-	const klass_t *k = obj(self)->klass;
-	while(k){
-		while(k && !k->to){
-			k = k->parent;
-		}
-		if(k){
-			obj_t *ret = k->to(self,klass);
-			if(ret){
-				return ret;
-			}
+	const klass_t *vt = obj_vt(self);
+	if(vt->to){
+		obj_t *ret = vt->to(self,klass);
+		if(ret){
+			return ret;
 		}
 	}
-	fprintf(stderr,"ERROR: obj_to() : Object %s cannot be converted to %s \n",obj(self)->name,klass->name);
+	fprintf(stderr,"ERROR: obj_to() : Object %s cannot be converted to %s \n",obj_name(self),klass->name);
 	return NULL;
 }
 int	obj_len(const obj_t *self){
-	const klass_t *k = obj(self)->klass;
-	while(k && !k->len){
-		k = k->parent;
-	}
-	if(k){
-		return k->len(self);
+	const klass_t *vt = obj_vt(self);
+	if(vt->len){
+		return vt->len(self);
 	}else{
 		return -1;
 	}
 }
 
+/*	ITERATORS	*/
+void		obj_iterator(const obj_t *self, obj_iter_t *it){
+	memset(it,0,sizeof(obj_iter_t));
+	it->self = self;
+	if(!self){
+		fprintf(stderr,"ERROR: obj_iterator() : iterating NULL\n");
+	}else if(!obj_is_immediate(self)){
+		const klass_t *vt = obj_vt(self);
+		if(vt->iterator){
+			vt->iterator(self,it);
+		}else{
+			fprintf(stderr,"ERROR: obj_iterator() : Object %s has no iterator() method\n",obj_name(self));
+		}
+	}
+}
+/* iterator slot for klasses that only have len() and get_index() */
+void		obj_iter_index(const obj_t *self, obj_iter_t *it){
+	it->kind = OBJ_ITER_INDEX;
+}
+int		obj_iter_next(obj_iter_t *it, obj_t **value){
+	switch(it->kind){
+	case OBJ_ITER_REFS:{
+		const array_obj *a = (const array_obj*)it->self;
+		if(it->index < a->length){
+			*value = a->array[it->index++];
+			return 1;
+		}
+		break;
+	}
+	case OBJ_ITER_LIST:{
+		const node_t *n = (const node_t*)it->node;
+		while(n && it->slot >= n->count){
+			n = n->next;
+			it->slot = 0;
+		}
+		it->node = n;
+		if(n){
+			*value = n->chunk->data[it->slot++];
+			it->index++;
+			return 1;
+		}
+		break;
+	}
+	case OBJ_ITER_FIELDS:{
+		const fieldtable_t *ft = obj(it->self)->field;
+		while(ft && it->slot < ft->table_length){
+			const field_t *f = &ft->table[it->slot++];
+			if(f->key){
+				it->key = f->key;
+				*value = f->data;
+				it->index++;
+				return 1;
+			}
+		}
+		break;
+	}
+	case OBJ_ITER_FLOATS:
+	case OBJ_ITER_INTS:{
+		const typedarray_obj *a = (const typedarray_obj*)it->self;
+		if(it->index < a->length){
+			if(it->kind == OBJ_ITER_FLOATS){
+				*value = obj_box(obj_new(Float,(double)((const float*)a->data)[it->index++]),"obj_iter_next");
+			}else{
+				*value = obj_box(obj_new(Int,(int)((const int32_t*)a->data)[it->index++]),"obj_iter_next");
+			}
+			return 1;
+		}
+		break;
+	}
+	case OBJ_ITER_INDEX:
+		if(it->index < obj_len(it->self)){
+			*value = obj_get_index(it->self,it->index++);
+			return 1;
+		}
+		break;
+	}
+	it->kind = OBJ_ITER_END;
+	*value = NULL;
+	return 0;
+}
+int		obj_iter_next_n(obj_iter_t *it, const void **span, int max){
+	int count = 0;
+	switch(it->kind){
+	case OBJ_ITER_REFS:
+	case OBJ_ITER_FLOATS:
+	case OBJ_ITER_INTS:{
+		int length;
+		if(it->kind == OBJ_ITER_REFS){
+			length = ((const array_obj*)it->self)->length;
+			*span = ((const array_obj*)it->self)->array + it->index;
+		}else{
+			length = ((const typedarray_obj*)it->self)->length;
+			*span = (const char*)((const typedarray_obj*)it->self)->data + it->index*sizeof(float);
+		}
+		count = length - it->index < max ? length - it->index : max;
+		break;
+	}
+	case OBJ_ITER_LIST:{
+		const node_t *n = (const node_t*)it->node;
+		while(n && it->slot >= n->count){
+			n = n->next;
+			it->slot = 0;
+		}
+		it->node = n;
+		if(n){
+			count = n->count - it->slot < max ? n->count - it->slot : max;
+			*span = n->chunk->data + it->slot;
+			it->slot += count;
+		}
+		break;
+	}
+	case OBJ_ITER_FIELDS:{
+		const fieldtable_t *ft = obj(it->self)->field;
+		while(ft && it->slot < ft->table_length && !ft->table[it->slot].key){
+			it->slot++;
+		}
+		if(ft && it->slot < ft->table_length){
+			*span = ft->table + it->slot;
+			while(count < max && it->slot < ft->table_length && ft->table[it->slot].key){
+				count++;
+				it->slot++;
+			}
+			it->key = ft->table[it->slot - 1].key;
+		}
+		break;
+	}
+	}
+	if(count > 0){
+		it->index += count;
+		return count;
+	}
+	it->kind = OBJ_ITER_END;
+	*span = NULL;
+	return 0;
+}
+
+/*	SIDE TABLES	*/
+/* Open addressing maps from object to a word, for the data only a few
+ * objects have, such as explicit names. The object has a flag set
+ * while it has an entry. */
+typedef struct side_entry_s{
+	const obj_t	*object;
+	uintptr_t	value;
+}side_entry_t;
+
+typedef struct side_table_s{
+	side_entry_t	*entries;
+	unsigned int	length;
+	unsigned int	count;
+	sync_lock_t	lock;
+}side_table_t;
+
+static unsigned int side_slot(const side_table_t *t, const obj_t *object){
+	uintptr_t h = (uintptr_t)object >> 4;
+	return (unsigned int)(h ^ (h >> 16)) & (t->length - 1);
+}
+static int side_find(const side_table_t *t, const obj_t *object){
+	unsigned int i;
+	if(!t->length){
+		return -1;
+	}
+	i = side_slot(t,object);
+	while(t->entries[i].object){
+		if(t->entries[i].object == object){
+			return i;
+		}
+		i = (i + 1) & (t->length - 1);
+	}
+	return -1;
+}
+static void side_place(side_table_t *t, const obj_t *object, uintptr_t value){
+	unsigned int i = side_slot(t,object);
+	while(t->entries[i].object && t->entries[i].object != object){
+		i = (i + 1) & (t->length - 1);
+	}
+	if(!t->entries[i].object){
+		t->count++;
+	}
+	t->entries[i].object = object;
+	t->entries[i].value  = value;
+}
+static int side_grow(side_table_t *t){
+	side_entry_t *old = t->entries;
+	unsigned int old_length = t->length;
+	unsigned int i;
+	unsigned int length = t->length ? t->length*2 : 64;
+	side_entry_t *e = calloc(length,sizeof(side_entry_t));
+	if(!e){
+		return 0;
+	}
+	t->entries = e;
+	t->length  = length;
+	t->count   = 0;
+	for(i = 0; i < old_length; i++){
+		if(old[i].object){
+			side_place(t,old[i].object,old[i].value);
+		}
+	}
+	free(old);
+	return 1;
+}
+/* returns 0 when out of memory */
+static int side_put(side_table_t *t, const obj_t *object, uintptr_t value){
+	if((t->count + 1)*2 > t->length && !side_grow(t)){
+		return 0;
+	}
+	side_place(t,object,value);
+	return 1;
+}
+static void side_remove(side_table_t *t, const obj_t *object){
+	int i = side_find(t,object);
+	unsigned int j;
+	if(i < 0){
+		return;
+	}
+	j = (i + 1) & (t->length - 1);
+	while(t->entries[j].object){
+		unsigned int home = side_slot(t,t->entries[j].object);
+		/* move back every entry whose home slot is not in ]i,j] */
+		if(((j - home) & (t->length - 1)) >= ((j - i) & (t->length - 1))){
+			t->entries[i] = t->entries[j];
+			i = j;
+		}
+		j = (j + 1) & (t->length - 1);
+	}
+	t->entries[i].object = NULL;
+	t->entries[i].value  = 0;
+	t->count--;
+}
+
+/*	NAMES		*/
+#define NAME_BUFFERS 8
+
+/* explicit names, the side table maps the object to its atom */
+static side_table_t names;
+
+void		obj_set_name(obj_t *self, const char *name){
+	if(obj_is_immediate(self)){
+		fprintf(stderr,"ERROR: obj_set_name() : %s values cannot be named\n",obj_klass(self)->name);
+	}else if(!name){
+		if(obj(self)->flags & OBJ_NAMED){
+			sync_lock(&names.lock);
+			side_remove(&names,self);
+			sync_unlock(&names.lock);
+			SYNC_AND(obj(self)->flags,~OBJ_NAMED);
+		}
+	}else{
+		const atom_t *a = atom(name);
+		if(!a){
+			return;
+		}
+		sync_lock(&names.lock);
+		if(side_put(&names,self,(uintptr_t)a)){
+			SYNC_OR(obj(self)->flags,OBJ_NAMED);
+		}else{
+			fprintf(stderr,"ERROR: obj_set_name() out of memory\n");
+		}
+		sync_unlock(&names.lock);
+	}
+}
+const char*	obj_name(const obj_t *self){
+	static THREAD_LOCAL char buffers[NAME_BUFFERS][NAME_LENGTH];
+	static THREAD_LOCAL int next = 0;
+	char *buf;
+	if(obj_is_immediate(self)){
+		return obj_klass(self)->name;
+	}else if(obj(self)->flags & OBJ_NAMED){
+		const char *name;
+		sync_lock(&names.lock);
+		name = ((const atom_t*)names.entries[side_find(&names,self)].value)->text;
+		sync_unlock(&names.lock);
+		return name;
+	}
+	buf = buffers[next];
+	next = (next + 1) % NAME_BUFFERS;
+	snprintf(buf,NAME_LENGTH,"%s%llu",obj(self)->klass->name,(unsigned long long)obj_uid(self));
+	return buf;
+}
+obj_uid_t	obj_uid(const obj_t *self){
+	if(obj_is_immediate(self)){
+		return 0;
+	}else{
+		unsigned int index = obj(self)->handle;
+		return handle_uid(index,handle_slot(index)->generation);
+	}
+}
+/*	WEAK REFERENCES		*/
+/* a weak handle is the uid of the object with the slot index shifted
+ * clear of the immediate tag bits */
+obj_weak_t	obj_weak(obj_t *self){
+	unsigned int index;
+	if(!self){
+		return 0;
+	}else if(obj_is_immediate(self)){	/* values never die */
+		return (obj_weak_t)(uintptr_t)self;
+	}
+	index = obj(self)->handle;
+	return ((obj_weak_t)handle_slot(index)->generation << 32) | ((obj_weak_t)index << OBJ_TAG_BITS);
+}
+obj_t*		obj_weak_get(obj_weak_t weak){
+	if(weak & OBJ_TAG_MASK){
+		return (obj_t*)(uintptr_t)weak;
+	}else if(!weak){
+		return NULL;
+	}
+	return handle_get((unsigned int)weak >> OBJ_TAG_BITS,(unsigned int)(weak >> 32));
+}
+const char*	obj_string(const obj_t *self){
+	if(self && obj_instance_of((obj_t*)self,String)){
+		return ((const string_obj*)self)->text;
+	}else{
+		fprintf(stderr,"ERROR: obj_string() : %s is not a String\n",self ? obj_name(self) : "NULL");
+		return NULL;
+	}
+}
+int		obj_int(const obj_t *self){
+#ifdef OBJ_IMMEDIATES
+	if(((uintptr_t)self & OBJ_TAG_MASK) == OBJ_TAG_INT){
+		return immediate_int(self);
+	}else if(((uintptr_t)self & OBJ_TAG_MASK) == OBJ_TAG_FLOAT){
+		return (int)immediate_float(self);
+	}
+#endif
+	if(self && obj_instance_of((obj_t*)self,Int)){
+		return ((const int_obj*)self)->value;
+	}else if(self && obj_instance_of((obj_t*)self,Float)){
+		return (int)((const float_obj*)self)->value;
+	}else{
+		fprintf(stderr,"ERROR: obj_int() : %s is not a number\n",self ? obj_name(self) : "NULL");
+		return 0;
+	}
+}
+float		obj_float(const obj_t *self){
+#ifdef OBJ_IMMEDIATES
+	if(((uintptr_t)self & OBJ_TAG_MASK) == OBJ_TAG_FLOAT){
+		return immediate_float(self);
+	}else if(((uintptr_t)self & OBJ_TAG_MASK) == OBJ_TAG_INT){
+		return (float)immediate_int(self);
+	}
+#endif
+	if(self && obj_instance_of((obj_t*)self,Float)){
+		return ((const float_obj*)self)->value;
+	}else if(self && obj_instance_of((obj_t*)self,Int)){
+		return (float)((const int_obj*)self)->value;
+	}else{
+		fprintf(stderr,"ERROR: obj_float() : %s is not a number\n",self ? obj_name(self) : "NULL");
+		return 0.0f;
+	}
+}
+
 /*	BASIC OBJECT CLASSES DEFINITIONS	*/
 
 static obj_t* __object_constructor(obj_t *self, va_list *app){
 	return self;
 }
 static obj_t* __object_destructor(obj_t *self){
+	const klass_t *k = obj(self)->klass;
+	if(obj(self)->field){
+		free_fieldtable(obj(self)->field);
+		obj(self)->field = NULL;
+	}
+	if(obj(self)->flags & OBJ_NAMED){
+		sync_lock(&names.lock);
+		side_remove(&names,self);
+		sync_unlock(&names.lock);
+	}
 	obj(self)->klass = NULL;
-	fprintf(stdout,"DESTR object:%s\n",obj(self)->name);
-	free(self);
+	slab_free(&k->info->pool,self);
 	return NULL;
 }
-static void __object_print(const obj_t *self, FILE *f){
-	fprintf(f,"object:%s",obj(self)->name);
+/* a table shared by clones is skipped like shared List and Array storage */
+static void traverse_fields(obj_t *self, obj_visit_t visit, void *ctx){
+	fieldtable_t *ft = obj(self)->field;
+	int i;
+	for(i = 0; ft && ft->owners == 1 && i < ft->table_length; i++){
+		if(ft->table[i].key){
+			visit(&ft->table[i].data,ctx);
+		}
+	}
+}
+static void __object_traverse(obj_t *self, obj_visit_t visit, void *ctx){
+	traverse_fields(self,visit,ctx);
+}
+static void __object_iterator(const obj_t *self, obj_iter_t *it){
+	it->kind = OBJ_ITER_FIELDS;
+}
+static void __object_print(const obj_t *self, writer_t *w){
+	writer_bytes(w,"object:",7);
+	writer_string(w,obj_name(self));
 }
 
+static klass_info_t object_info;
 const klass_t object_klass = {
 	NULL,
 	sizeof(object_t),
@@ -415,55 +1472,117 @@ const klass_t object_klass = {
 	NULL,	//rem
 	NULL,	//rem_index
 	NULL,	//len
-	NULL	//iterator
+	__object_iterator,
+	__object_traverse,
+	&object_info	//info
 };
 const klass_t * Object = &object_klass;
 
 /* 	STRING 		*/
+/* copies text to the inline buffer or to the heap */
+static void string_init(string_obj *self, const char *text, int length){
+	if(length < STRING_INLINE){
+		self->text = self->inline_text;
+	}else if(!(self->text = malloc(length + 1))){
+		fprintf(stderr,"ERROR: String : out of memory for %d bytes\n",length);
+		self->text = self->inline_text;
+		length = 0;
+	}else{
+		HEAP_ALLOC(HEAP_TEXT,length + 1);
+	}
+	memcpy(self->text,text,length);
+	self->text[length] = '\0';
+	self->text_length = length;
+}
 static obj_t* __string_constructor(obj_t *_self, va_list *app){
 	string_obj *self = (string_obj*)_self;
 	const char * text = va_arg(*app,const char *);
-	self->text_length = strlen(text);
-	self->text = malloc(self->text_length + 1);
-	memset(self->text,0,self->text_length);
-	strncpy(self->text,text,self->text_length+1);
+	if(!text){	/* storage is provided by the caller, see string_from_atom() */
+		return self;
+	}
+	string_init(self,text,strlen(text));
 	return self;
 }
-static void __string_print(const obj_t *_self, FILE *f){
+/* quotes, backslashes, newlines and tabs are escaped */
+static void __string_print(const obj_t *_self, writer_t *w){
 	string_obj *self = (string_obj*)_self;
-	fprintf(f,"\"%s\"", self->text);
+	const char *s = self->text;
+	int i, start = 0;
+	writer_char(w,'"');
+	for(i = 0; i < self->text_length; i++){
+		char c = s[i];
+		if(c == '"' || c == '\\' || c == '\n' || c == '\t'){
+			writer_bytes(w,s + start,i - start);
+			writer_char(w,'\\');
+			writer_char(w,c == '\n' ? 'n' : c == '\t' ? 't' : c);
+			start = i + 1;
+		}
+	}
+	writer_bytes(w,s + start,i - start);
+	writer_char(w,'"');
 }
 static obj_t* __string_destructor(obj_t*_self){
 	string_obj *self = (string_obj*)_self;
-	fprintf(stdout,"DESTR string:%s\n",obj(self)->name);
-	free(self->text);
+	if(self->storage){
+		obj_unref(self->storage);
+	}else if(!self->atom && self->text != self->inline_text){
+		HEAP_FREE(HEAP_TEXT,self->text_length + 1);
+		free(self->text);
+	}
 	return _self;
 }
+static obj_t* __string_clone(obj_t *_self){
+	string_obj *self = (string_obj*)_self;
+	string_obj *c = (string_obj*)obj_copy(_self);
+	if(!c){
+		return NULL;
+	}else if(c->storage){
+		obj_ref(c->storage);
+	}else if(self->text == self->inline_text){
+		c->text = c->inline_text;
+	}else if(!c->atom){
+		c->text = malloc(c->text_length + 1);
+		if(!c->text){
+			fprintf(stderr,"ERROR: obj_clone(%s) out of memory\n",obj_name(_self));
+			c->text = c->inline_text;
+			obj_unref(c);
+			return NULL;
+		}
+		HEAP_ALLOC(HEAP_TEXT,c->text_length + 1);
+		memcpy(c->text,self->text,c->text_length + 1);
+	}
+	obj(c)->flags |= obj(self)->flags & OBJ_HASHED;
+	return c;
+}
+/* strings of different lengths or hashes differ without reading them */
 static int __string_equals(const obj_t *_self, const obj_t *_b){
 	string_obj *self = (string_obj*)_self;
 	string_obj *b    = (string_obj*)_b;
-	if(self->text_length == b->text_length){
-		return !strncmp(self->text,b->text,self->text_length);
+	if(self->atom && b->atom){
+		return self->atom == b->atom;
+	}else if(self->text_length != b->text_length || hash_differs(_self,self->hash,_b,b->hash)){
+		return 0;
 	}
-	return 0;
+	return !memcmp(self->text,b->text,self->text_length);
 }
 static unsigned int __string_hash(const obj_t *_self){
 	string_obj *self = (string_obj*)_self;
-	unsigned int hash = 5381;
-	int i = self->text_length;
-	while(i--){
-		hash = (hash << 5) + hash + self->text[i];
+	if(hash_cached(_self)){
+		return self->hash;
+	}else if(self->atom){
+		return hash_store(_self,&self->hash,self->atom->hash,1);
 	}
-	return hash;
+	return hash_store(_self,&self->hash,atom_hash_string(self->text,self->text_length),1);
 }
 
+static klass_info_t string_info;
 const klass_t string_klass = {
 	&object_klass,
 	sizeof(string_obj),
 	"String",
 	__string_constructor,
 	__string_destructor,
-	NULL,
+	__string_clone,
 	__string_equals,
 	__string_print,
 	__string_hash,	
@@ -476,29 +1595,60 @@ const klass_t string_klass = {
 	NULL,	//rem
 	NULL,	//rem_index
 	NULL,	//len
-	NULL	//iterator
+	NULL,	//iterator
+	NULL,	//traverse
+	&string_info	//info
 };
 const klass_t * String = &string_klass;
 
+obj_t*	string_from_atom(const atom_t *a){
+	string_obj *self = (string_obj*)obj_new(String,NULL);
+	if(self){
+		self->atom = a;
+		self->text = (char*)a->text;
+		self->text_length = a->length;
+	}
+	return self;
+}
+obj_t*	string_from_text(const char *text, int length){
+	string_obj *self = (string_obj*)obj_new(String,NULL);
+	if(self){
+		string_init(self,text,length);
+	}
+	return self;
+}
+const atom_t*	string_atom(obj_t *_self){
+	string_obj *self = (string_obj*)_self;
+	if(!obj_instance_of(_self,String)){
+		fprintf(stderr,"ERROR: string_atom() : %s is not a String\n",obj_name(_self));
+		return NULL;
+	}else if(!self->atom){
+		self->atom = atom_len(self->text,self->text_length);
+		if(self->atom){
+			if(self->storage){
+				obj_unref(self->storage);
+				self->storage = NULL;
+			}else if(self->text != self->inline_text){
+				HEAP_FREE(HEAP_TEXT,self->text_length + 1);
+				free(self->text);
+			}
+			self->text = (char*)self->atom->text;
+		}
+	}
+	return self->atom;
+}
+
 /* 	FLOAT 		*/
 static obj_t* __float_constructor(obj_t *_self, va_list *app){
 	float_obj *self = (float_obj*)_self;
 	self->value = (float)(va_arg(*app,double));
 	return self;
 }
-static void __float_print(const obj_t *_self, FILE *f){
-	float_obj *self = (float_obj*)_self;
-	fprintf(f,"%f",self->value);
-}
-static obj_t* __float_destructor(obj_t*_self){
-	float_obj *self = (float_obj*)_self;
-	fprintf(stdout,"DESTR float:%s\n",obj(self)->name);
-	return _self;
+static void __float_print(const obj_t *_self, writer_t *w){
+	writer_float(w,obj_float(_self));
 }
 static int __float_equals(const obj_t *_self, const obj_t *_b){
-	float_obj *self = (float_obj*)_self;
-	float_obj *b    = (float_obj*)_b;
-	float x = self->value - b->value;
+	float x = obj_float(_self) - obj_float(_b);
 	if(x < 0){
 		x = -x;
 	}
@@ -509,15 +1659,15 @@ static int __float_equals(const obj_t *_self, const obj_t *_b){
 	}
 }
 static unsigned int __float_hash(const obj_t *_self){
-	float_obj *self = (float_obj*)_self;
-	return ((unsigned int)(self->value*1000)) % 1073741824;
+	return ((unsigned int)(obj_float(_self)*1000)) % 1073741824;
 }
+static klass_info_t float_info;
 const klass_t float_klass = {
 	&object_klass,
 	sizeof(float_obj),
 	"Float",
 	__float_constructor,
-	__float_destructor,
+	NULL,	//destructor
 	NULL,
 	__float_equals,
 	__float_print,
@@ -531,7 +1681,9 @@ const klass_t float_klass = {
 	NULL,	//rem
 	NULL,	//rem_index
 	NULL,	//len
-	NULL	//iterator
+	NULL,	//iterator
+	NULL,	//traverse
+	&float_info	//info
 };
 const klass_t * Float = &float_klass;
 
@@ -541,30 +1693,22 @@ static obj_t* __int_constructor(obj_t *_self, va_list *app){
 	self->value = (int)(va_arg(*app,int));
 	return self;
 }
-static void __int_print(const obj_t *_self, FILE *f){
-	int_obj *self = (int_obj*)_self;
-	fprintf(f,"%d",self->value);
-}
-static obj_t* __int_destructor(obj_t*_self){
-	int_obj *self = (int_obj*)_self;
-	fprintf(stdout,"DESTR Int:%s\n",obj(self)->name);
-	return _self;
+static void __int_print(const obj_t *_self, writer_t *w){
+	writer_int(w,obj_int(_self));
 }
 static int __int_equals(const obj_t *_self, const obj_t *_b){
-	int_obj *self = (int_obj*)_self;
-	int_obj *b    = (int_obj*)_b;
-	return self->value == b->value;
+	return obj_int(_self) == obj_int(_b);
 }
 static unsigned int __int_hash(const obj_t *_self){
-	int_obj *self = (int_obj*)_self;
-	return self->value % 1073741824;
+	return obj_int(_self) % 1073741824;
 }
+static klass_info_t int_info;
 const klass_t int_klass = {
 	&object_klass,
 	sizeof(int_obj),
 	"Int",
 	__int_constructor,
-	__int_destructor,
+	NULL,	//destructor
 	NULL,
 	__int_equals,
 	__int_print,
@@ -578,7 +1722,9 @@ const klass_t int_klass = {
 	NULL,	//rem
 	NULL,	//rem_index
 	NULL,	//len
-	NULL	//iterator
+	NULL,	//iterator
+	NULL,	//traverse
+	&int_info	//info
 };
 const klass_t * Int = &int_klass;
 
@@ -586,44 +1732,69 @@ const klass_t * Int = &int_klass;
 static obj_t* __hashtable_constructor(obj_t *_self, va_list *app){
 	return _self;
 }
-static void __hashtable_print(const obj_t *_self, FILE *file){
+static void __hashtable_print(const obj_t *_self, writer_t *w){
 	object_t *self = (object_t*)_self;
 	if(!self->field){
-		fprintf(file,"{}");
+		writer_bytes(w,"{}",2);
 	}else{
 		int i = self->field->table_length;
-		fprintf(file,"{");
+		writer_char(w,'{');
 		while(i--){
-			field_t *f = self->field->table[i];
-			while(f){
-				//fprintf(file,"%s:%s ",f->key,obj(f->data)->name);
-				fprintf(file,"%s:",f->key);
-				obj_printf(file,f->data);
-				fprintf(file," ");
-				f = f->next;
+			const field_t *f = &self->field->table[i];
+			if(f->key){
+				writer_bytes(w,f->key->text,f->key->length);
+				writer_char(w,':');
+				obj_write(w,f->data);
+				writer_char(w,' ');
 			}
 		}
-		fprintf(file,"}");
+		writer_char(w,'}');
 	}
 }
-static obj_t* __hashtable_destructor(obj_t*_self){
-	fprintf(stdout,"DESTR (TODO) hashtable:%s\n",obj(_self)->name);
-	return _self;
-}
 static int __hashtable_equals(const obj_t *_self, const obj_t *_b){
-	fprintf(stdout,"TODO : implement Hashtable Equals\n");
-	return 0;
+	const hashtable_obj *self = (const hashtable_obj*)_self;
+	const hashtable_obj *b    = (const hashtable_obj*)_b;
+	const fieldtable_t *ft = self->___.field;
+	int i;
+	if(!ft || !ft->field_count){
+		return !b->___.field || !b->___.field->field_count;
+	}else if(!b->___.field || b->___.field->field_count != ft->field_count
+			|| hash_differs(_self,self->hash,_b,b->hash)){
+		return 0;
+	}
+	for(i = 0; i < ft->table_length; i++){
+		const field_t *f = &ft->table[i];
+		if(f->key && !obj_equals(f->data,fieldtable_get(b->___.field,f->key))){
+			return 0;
+		}
+	}
+	return 1;
 }
+/* fields are summed so their order in the table does not matter */
 static unsigned int __hashtable_hash(const obj_t *_self){
-	fprintf(stdout,"TODO : implement Hashtable Hash\n");
-	return 0;
+	hashtable_obj *self = (hashtable_obj*)_self;
+	const fieldtable_t *ft = self->___.field;
+	unsigned int h = 0;
+	int i, leaves = 1;
+	if(hash_cached(_self)){
+		return self->hash;
+	}
+	for(i = 0; ft && i < ft->table_length; i++){
+		const field_t *f = &ft->table[i];
+		if(f->key){
+			h += obj_hash_finish(obj_hash_combine(f->hash,hash_element(f->data)));
+			leaves = leaves && hash_is_leaf(f->data);
+		}
+	}
+	return hash_store(_self,&self->hash,obj_hash_finish(h),leaves);
 }
+static klass_info_t hashtable_info;
 const klass_t hashtable_klass = {
 	&object_klass,
 	sizeof(hashtable_obj),
 	"HashTable",
 	__hashtable_constructor,
-	__hashtable_destructor,
+	NULL,	//destructor
 	NULL,
 	__hashtable_equals,
 	__hashtable_print,
@@ -637,26 +1808,227 @@ const klass_t hashtable_klass = {
 	NULL,	//rem
 	NULL,	//rem_index
 	NULL,	//len
-	NULL	//iterator
+	NULL,	//iterator
+	NULL,	//traverse
+	&hashtable_info	//info
 };
 const klass_t * HashTable = &hashtable_klass;
 void	hashtable_set(obj_t *_self, const char *key, obj_t *value){
 	if(obj_instance_of(_self,HashTable)){
 		obj_set_field(_self,key,value);
 	}else{
-		fprintf(stderr,"ERROR: hashtable_set() : %s is not an HashTable\n",obj(_self)->name);
+		fprintf(stderr,"ERROR: hashtable_set() : %s is not an HashTable\n",obj_name(_self));
 	}
 }
 obj_t*  hashtable_get(obj_t *_self, const char *key){
 	if(obj_instance_of(_self,HashTable)){
 		return obj_get_field(_self,key);
 	}else{
-		fprintf(stderr,"ERROR: hashtable_get() : %s is not an HashTable\n",obj(_self)->name);
+		fprintf(stderr,"ERROR: hashtable_get() : %s is not an HashTable\n",obj_name(_self));
 		return NULL;
 	}
 }
 
 /* 	LIST	*/
+/* Lists are unrolled: each node holds up to LIST_NODE_LENGTH elements.
+ * The list remembers the last node it accessed (current) and the index of
+ * that node's first element (current_index), so walking a list by
+ * increasing or decreasing index only ever steps to a neighbour node. */
+static slab_pool_t node_pool;
+static slab_pool_t chunk_pool;
+static sync_lock_t node_pool_lock = 0;
+
+/* Cloned lists share their nodes until one of them is written to, it then
+ * gets nodes of its own that still share their chunks, and a chunk is
+ * copied when a node writes to it. */
+static void pools_init(void){
+	if(!SYNC_LOAD(node_pool.slot_size)){
+		sync_lock(&node_pool_lock);
+		if(!node_pool.slot_size){
+			/* nodes belong to the List, which may outlive any arena */
+			slab_pool_init(&chunk_pool,"ListChunk",sizeof(chunk_t),0);
+			SYNC_FENCE();
+			slab_pool_init(&node_pool,"ListNode",sizeof(node_t),0);
+		}
+		sync_unlock(&node_pool_lock);
+	}
+}
+/* a new node with the given chunk, or an empty one */
+static node_t *new_node(chunk_t *chunk){
+	node_t *n;
+	pools_init();
+	n = slab_alloc(&node_pool);
+	if(!n){
+		fprintf(stderr,"ERROR: List : new_node() out of memory\n");
+		return NULL;
+	}
+	if(chunk){
+		SYNC_INC(chunk->owners);
+	}else if((chunk = slab_alloc(&chunk_pool))){
+		chunk->owners = 1;
+		HEAP_ALLOC(HEAP_NODES,chunk_pool.slot_size);
+	}else{
+		fprintf(stderr,"ERROR: List : new_node() out of memory\n");
+		slab_free(&node_pool,n);
+		return NULL;
+	}
+	HEAP_ALLOC(HEAP_NODES,node_pool.slot_size);
+	n->next  = NULL;
+	n->prev  = NULL;
+	n->count = 0;
+	n->chunk = chunk;
+	return n;
+}
+/* the last owner of a chunk releases its elements */
+static void free_node(node_t *n){
+	int owners = SYNC_DEC(n->chunk->owners);
+	if(owners == 1){
+		gc_unshared(n->chunk->data,n->count);
+	}else if(!owners){
+		int i = n->count;
+		while(i--){
+			obj_unref(n->chunk->data[i]);
+		}
+		HEAP_FREE(HEAP_NODES,chunk_pool.slot_size);
+		slab_free(&chunk_pool,n->chunk);
+	}
+	HEAP_FREE(HEAP_NODES,node_pool.slot_size);
+	slab_free(&node_pool,n);
+}
+static void free_nodes(node_t *n){
+	while(n){
+		node_t *next = n->next;
+		free_node(n);
+		n = next;
+	}
+}
+/* gives the list nodes of its own, returns 0 when out of memory */
+static int list_own(list_obj *self){
+	node_t *n, *first = NULL, *last = NULL;
+	if(!self->shared){
+		return 1;
+	}else if(SYNC_LOAD(*self->shared) > 1){
+		for(n = self->first; n; n = n->next){
+			node_t *m = new_node(n->chunk);
+			if(!m){
+				free_nodes(first);
+				return 0;
+			}
+			m->count = n->count;
+			m->prev  = last;
+			if(last){
+				last->next = m;
+			}else{
+				first = m;
+			}
+			last = m;
+		}
+		if(SYNC_DEC(*self->shared)){
+			self->first = first;
+			self->last  = last;
+			self->current = NULL;
+			self->current_index = 0;
+			self->shared = NULL;
+			return 1;
+		}
+		/* the other owners went away meanwhile */
+		free_nodes(first);
+	}
+	free(self->shared);
+	self->shared = NULL;
+	return 1;
+}
+/* gives the node a chunk of its own, the list must own its nodes */
+static int node_own(node_t *n){
+	chunk_t *c;
+	int i;
+	if(SYNC_LOAD(n->chunk->owners) == 1){
+		return 1;
+	}
+	c = slab_alloc(&chunk_pool);
+	if(!c){
+		fprintf(stderr,"ERROR: List : node_own() out of memory\n");
+		return 0;
+	}
+	HEAP_ALLOC(HEAP_NODES,chunk_pool.slot_size);
+	c->owners = 1;
+	memcpy(c->data,n->chunk->data,n->count*sizeof(obj_t*));
+	for(i = 0; i < n->count; i++){
+		if(c->data[i]){
+			obj_ref(c->data[i]);
+		}
+	}
+	i = SYNC_DEC(n->chunk->owners);
+	if(i == 1){
+		gc_unshared(n->chunk->data,n->count);
+	}else if(!i){
+		/* the other owners went away meanwhile */
+		for(i = 0; i < n->count; i++){
+			obj_unref(n->chunk->data[i]);
+		}
+		HEAP_FREE(HEAP_NODES,chunk_pool.slot_size);
+		slab_free(&chunk_pool,n->chunk);
+	}
+	n->chunk = c;
+	return 1;
+}
+/* links a new empty node after n, or first if n is NULL */
+static node_t *list_link_after(list_obj *self, node_t *n){
+	node_t *m = new_node(NULL);
+	if(!m){
+		return NULL;
+	}
+	m->prev = n;
+	m->next = n ? n->next : self->first;
+	if(m->next){
+		m->next->prev = m;
+	}else{
+		self->last = m;
+	}
+	if(n){
+		n->next = m;
+	}else{
+		self->first = m;
+	}
+	return m;
+}
+static void list_unlink(list_obj *self, node_t *n){
+	if(n->prev){
+		n->prev->next = n->next;
+	}else{
+		self->first = n->next;
+	}
+	if(n->next){
+		n->next->prev = n->prev;
+	}else{
+		self->last = n->prev;
+	}
+	free_node(n);
+}
+/* moves the cursor to the node holding index, which must be in range */
+static node_t *list_seek(list_obj *self, int index){
+	node_t *n = self->current;
+	int base  = self->current_index;
+	if(!n || (index < base && index < base - index)){
+		n = self->first;
+		base = 0;
+	}
+	if(index >= base + n->count && self->length - index < index - base){
+		n = self->last;
+		base = self->length - n->count;
+	}
+	while(index >= base + n->count){
+		base += n->count;
+		n = n->next;
+	}
+	while(index < base){
+		n = n->prev;
+		base -= n->count;
+	}
+	self->current = n;
+	self->current_index = base;
+	return n;
+}
 static obj_t* __list_constructor(obj_t *_self, va_list *app){
 	list_obj *self = (list_obj*)_self;
 	self->length = 0;
@@ -666,65 +2038,129 @@ static obj_t* __list_constructor(obj_t *_self, va_list *app){
 	self->current_index = 0;
 	return _self;
 }
-static void __list_print(const obj_t *_self, FILE *file){
+static void __list_print(const obj_t *_self, writer_t *w){
 	list_obj *self = (list_obj*)_self;
 	if(!self->first){
-		fprintf(file,"[]");
+		writer_bytes(w,"[]",2);
 	}else{
 		node_t *n = self->first;
-		fprintf(file,"[");
+		writer_char(w,'[');
 		while(n){
-			//fprintf(file,"%s:%s ",f->key,obj(f->data)->name);
-			obj_printf(file,n->data);
-			fprintf(file," ");
+			int i;
+			for(i = 0; i < n->count; i++){
+				obj_write(w,n->chunk->data[i]);
+				writer_char(w,' ');
+			}
 			n = n->next;
 		}
-		fprintf(file,"]");
+		writer_char(w,']');
 	}
 }
 static obj_t* __list_destructor(obj_t*_self){
 	list_obj *self = (list_obj*)_self;
-	node_t *n = self->first;
-	fprintf(stdout,"DESTR: List:%s\n",obj(_self)->name);
-	while(n){
-		node_t *tmp = NULL;
-		if(n->data){
-			obj_unref(n->data);
+	node_t *n;
+	if(self->shared){
+		int owners = SYNC_DEC(*self->shared);
+		for(n = self->first; owners == 1 && n; n = n->next){
+			gc_unshared(n->chunk->data,n->count);
+		}
+		if(owners){
+			return _self;
 		}
-		tmp = n->next;
-		free(n);
-		n = tmp;
+		free(self->shared);
 	}
+	free_nodes(self->first);
 	return _self;
 }
+/* the clone shares the nodes of self */
+static obj_t* __list_clone(obj_t *_self){
+	list_obj *self = (list_obj*)_self;
+	list_obj *c;
+	if(self->first && !self->shared){
+		self->shared = (int*)malloc(sizeof(int));
+		if(!self->shared){
+			fprintf(stderr,"ERROR: obj_clone() : out of memory\n");
+			return NULL;
+		}
+		*self->shared = 1;
+	}
+	c = (list_obj*)obj_copy(_self);
+	if(c && c->shared){
+		SYNC_INC(*c->shared);
+	}
+	return c;
+}
 static int __list_equals(const obj_t *_self, const obj_t *_b){
-	fprintf(stdout,"TODO : implement List Equals\n");
-	return 0;
+	const list_obj *self = (const list_obj*)_self;
+	const list_obj *b    = (const list_obj*)_b;
+	return !hash_differs(_self,self->hash,_b,b->hash) && sequence_equals(_self,_b);
 }
 static unsigned int __list_hash(const obj_t *_self){
-	fprintf(stdout,"TODO : implement list Hash\n");
-	return 0;
+	list_obj *self = (list_obj*)_self;
+	unsigned int h;
+	int leaves;
+	if(hash_cached(_self)){
+		return self->hash;
+	}
+	h = sequence_hash(_self,&leaves);
+	return hash_store(_self,&self->hash,h,leaves);
 }
-const klass_t list_klass = {
-	&object_klass,
-	sizeof(list_obj),
-	"List",
-	__list_constructor,
+static obj_t*	__list_get_index(const obj_t *self, int index){
+	return list_get((obj_t*)self,index);
+}
+static void	__list_set_index(obj_t *self, int index, obj_t *data){
+	list_set(self,index,data);
+}
+static void	__list_append(obj_t *self, obj_t *data){
+	list_append(self,data);
+}
+static void	__list_rem_index(obj_t *self, int index){
+	list_remove(self,index);
+}
+static int	__list_len(const obj_t *self){
+	return ((const list_obj*)self)->length;
+}
+static void __list_iterator(const obj_t *self, obj_iter_t *it){
+	it->kind = OBJ_ITER_LIST;
+	it->node = ((const list_obj*)self)->first;
+}
+/* shared nodes and chunks are skipped, their elements are counted as
+ * referenced from outside, which keeps them alive */
+static void __list_traverse(obj_t *self, obj_visit_t visit, void *ctx){
+	const list_obj *l = (const list_obj*)self;
+	node_t *n = l->shared && *l->shared > 1 ? NULL : l->first;
+	int i;
+	traverse_fields(self,visit,ctx);
+	while(n){
+		for(i = 0; n->chunk->owners == 1 && i < n->count; i++){
+			visit(&n->chunk->data[i],ctx);
+		}
+		n = n->next;
+	}
+}
+static klass_info_t list_info;
+const klass_t list_klass = {
+	&object_klass,
+	sizeof(list_obj),
+	"List",
+	__list_constructor,
 	__list_destructor,
-	NULL,
+	__list_clone,
 	__list_equals,
 	__list_print,
 	__list_hash,	
 	NULL,	//to
 	NULL,	//get
-	NULL,	//get_index
+	__list_get_index,
 	NULL,	//set
-	NULL,	//set_index
-	NULL,	//append
+	__list_set_index,
+	__list_append,
 	NULL,	//rem
-	NULL,	//rem_index
-	NULL,	//len
-	NULL	//iterator
+	__list_rem_index,
+	__list_len,
+	__list_iterator,
+	__list_traverse,
+	&list_info	//info
 };
 const klass_t * List = &list_klass;
 
@@ -733,7 +2169,7 @@ int list_length(obj_t *_self){
 	if(obj_instance_of(_self,List)){
 		return self->length;
 	}else{
-		fprintf(stderr,"ERROR: list_length() : %s is not a List\n",obj(_self)->name);
+		fprintf(stderr,"ERROR: list_length() : %s is not a List\n",obj_name(_self));
 		return 0;
 	}
 }
@@ -744,21 +2180,11 @@ obj_t*  list_get(obj_t *_self, int index){
 			fprintf(stderr,"ERROR: list_get() : index %d out of range [0,%d[\n",index,self->length);
 			return NULL;
 		}else{
-			node_t *n = self->first;
-			int i = 0;
-			while(n){
-				if(i == index){
-					return n->data;
-				}else{
-					n = n->next;
-					i++;
-				}
-			}
-			fprintf(stderr,"ERROR: list_get() : FIXME : list %s length doesn't match real length\n",obj(self)->name);
-			return NULL;
+			node_t *n = list_seek(self,index);
+			return n->chunk->data[index - self->current_index];
 		}
 	}else{
-		fprintf(stderr,"ERROR: list_get() : %s is not a List\n",obj(_self)->name);
+		fprintf(stderr,"ERROR: list_get() : %s is not a List\n",obj_name(_self));
 		return NULL;
 	}
 }
@@ -768,69 +2194,132 @@ void	list_set(obj_t *_self, int index,obj_t *data){
 		if(index < 0 || index >= self->length){
 			fprintf(stderr,"ERROR: list_set() : index %d out of range [0,%d[\n",index,self->length);
 			return;
-		}else{
-			node_t *n = self->first;
-			int i = 0;
-			while(n){
-				if(i == index){
-					obj_t *old = n->data;
-					n->data = data;
-					obj_ref(data);
-					obj_unref(old);
-					return;
-				}else{
-					n = n->next;
-					i++;
-				}
+		}else if(list_own(self)){
+			node_t *n = list_seek(self,index);
+			obj_t *old;
+			if(!node_own(n)){
+				return;
 			}
-			fprintf(stderr,"ERROR: list_set() : FIXME : list %s length doesn't match real length\n",obj(self)->name);
-			return;
+			old = n->chunk->data[index - self->current_index];
+			hash_invalidate(self);
+			n->chunk->data[index - self->current_index] = data ? obj_ref(data) : NULL;
+			obj_unref(old);
 		}
 	}else{
-		fprintf(stderr,"ERROR: list_set() : %s is not a List\n",obj(_self)->name);
+		fprintf(stderr,"ERROR: list_set() : %s is not a List\n",obj_name(_self));
 		return;
 	}
 }
 int	list_append(obj_t *_self, obj_t *data){
 	list_obj *self = (list_obj*)_self;
 	if(obj_instance_of(_self,List)){
-		node_t *n = (node_t*)malloc(sizeof(node_t));
-		n->next = NULL;
-		n->data = data;
-		obj_ref(data);
-		if(self->length == 0){
-			self->first = n;
-			self->last  = n;
-			self->length = 1;
-			return 1;
-		}else{
-			self->last->next = n;
-			self->last = n;
-			self->length += 1;
+		node_t *n;
+		if(!list_own(self)){
 			return self->length;
 		}
+		n = self->last;
+		if(n && n->count < LIST_NODE_LENGTH && !node_own(n)){
+			return self->length;
+		}else if(!n || n->count == LIST_NODE_LENGTH){
+			n = list_link_after(self,n);
+			if(!n){
+				return self->length;
+			}
+		}
+		hash_invalidate(self);
+		n->chunk->data[n->count++] = data ? obj_ref(data) : NULL;
+		self->length += 1;
+		return self->length;
 	}else{
-		fprintf(stderr,"ERROR: list_append() : %s is not a List\n",obj(_self)->name);
+		fprintf(stderr,"ERROR: list_append() : %s is not a List\n",obj_name(_self));
 		return 0;
 	}
 }
+void	list_insert(obj_t *_self, int index, obj_t *data){
+	list_obj *self = (list_obj*)_self;
+	if(!obj_instance_of(_self,List)){
+		fprintf(stderr,"ERROR: list_insert() : %s is not a List\n",obj_name(_self));
+	}else if(index < 0 || index > self->length){
+		fprintf(stderr,"ERROR: list_insert() : index %d out of range [0,%d]\n",index,self->length);
+	}else if(index == self->length){
+		list_append(_self,data);
+	}else if(list_own(self)){
+		node_t *n = list_seek(self,index);
+		int i = index - self->current_index;
+		if(!node_own(n)){
+			return;
+		}
+		if(n->count == LIST_NODE_LENGTH){
+			/* split the full node, its upper half moves to a new node */
+			int half = LIST_NODE_LENGTH/2;
+			node_t *m = list_link_after(self,n);
+			if(!m){
+				return;
+			}
+			memcpy(m->chunk->data,n->chunk->data + half,(LIST_NODE_LENGTH - half)*sizeof(obj_t*));
+			m->count = LIST_NODE_LENGTH - half;
+			n->count = half;
+			if(i > half){
+				self->current = m;
+				self->current_index += half;
+				i -= half;
+				n = m;
+			}
+		}
+		hash_invalidate(self);
+		memmove(n->chunk->data + i + 1,n->chunk->data + i,(n->count - i)*sizeof(obj_t*));
+		n->chunk->data[i] = data ? obj_ref(data) : NULL;
+		n->count++;
+		self->length++;
+	}
+}
+/* Elements are copied node by node. The length of data is read first so
+ * a list can be extended with itself. */
 int	list_extend(obj_t*_self, obj_t *data){
 	list_obj *self = (list_obj*)_self;
 	if(obj_instance_of(_self,List)){
 		if(obj_instance_of(data,List)){
 			list_obj *list2 = (list_obj*)data;
-			node_t*n = list2->first;
-			int dist = self->length;
-			while(n){
-				dist = list_append(self,n->data);
-				n = n->next;
+			node_t *src;
+			int remaining = list2->length;
+			if(!list_own(self) || (self->last && !node_own(self->last))){
+				return self->length;
+			}
+			src = list2->first;
+			hash_invalidate(self);
+			while(src && remaining){
+				int count = src->count < remaining ? src->count : remaining;
+				int done = 0;
+				while(done < count){
+					node_t *dst = self->last;
+					int room, k, i;
+					if(!dst || dst->count == LIST_NODE_LENGTH){
+						dst = list_link_after(self,dst);
+						if(!dst){
+							return self->length;
+						}
+					}
+					room = LIST_NODE_LENGTH - dst->count;
+					k = count - done < room ? count - done : room;
+					memcpy(dst->chunk->data + dst->count,src->chunk->data + done,k*sizeof(obj_t*));
+					for(i = 0; i < k; i++){
+						if(dst->chunk->data[dst->count + i]){
+							obj_ref(dst->chunk->data[dst->count + i]);
+						}
+					}
+					dst->count   += k;
+					self->length += k;
+					done += k;
+				}
+				remaining -= count;
+				src = src->next;
 			}
-			return dist;
+			return self->length;
 		}else{
 			return list_append(self,data);
 		}
 	}else{
-		fprintf(stderr,"ERROR: list_extend() : %s is not a List\n",obj(_self)->name);
+		fprintf(stderr,"ERROR: list_extend() : %s is not a List\n",obj_name(_self));
 		return 0;
 	}
 }
@@ -840,88 +2329,180 @@ void list_remove(obj_t *_self, int index){
 		if(index < 0 || index >= self->length){
 			fprintf(stderr,"ERROR: list_remove() : index %d out of range [0,%d[\n",index,self->length);
 			return;
-		}else{
-			node_t *n = self->first;
-			node_t *prev = NULL;
+		}else if(list_own(self)){
+			node_t *n = list_seek(self,index);
+			int i = index - self->current_index;
 			obj_t *ret;
-			int i = 0;
-			while(n){
-				if(i == index){
-					if(i == self->length -1){
-						self->last = prev;
-					}
-					if(prev){
-						prev->next = n->next;
-					}else{
-						self->first = n->next;
-					}
-					ret = n->data;
-					free(n);
-					obj_unref(ret);
-					return;
-				}else{
-					prev = n;
-					n = n->next;
-					i++;
-				}
+			if(!node_own(n)){
+				return;
 			}
-			fprintf(stderr,"ERROR: list_remove() : FIXME : list %s length doesn't match real length\n",obj(self)->name);
-			return;
+			ret = n->chunk->data[i];
+			hash_invalidate(self);
+			memmove(n->chunk->data + i,n->chunk->data + i + 1,(n->count - i - 1)*sizeof(obj_t*));
+			n->count--;
+			self->length--;
+			if(!n->count){
+				self->current = n->next;
+				list_unlink(self,n);
+			}
+			obj_unref(ret);
 		}
 	}else{
-		fprintf(stderr,"ERROR: list_remove() : %s is not a List\n",obj(_self)->name);
+		fprintf(stderr,"ERROR: list_remove() : %s is not a List\n",obj_name(_self));
 		return;
 	}
 }
 
 /* 	ARRAY	*/
+/* Arrays are contiguous and grow by doubling their capacity, so append
+ * is amortized O(1). obj_new(Array,n) creates an Array of n NULLs. */
+#define ARRAY_MIN 4
+
+static int array_grow(array_obj *self, int capacity){
+	obj_t **a;
+	if(capacity <= self->capacity){
+		return 1;
+	}
+	a = (obj_t**)realloc(self->array,capacity*sizeof(obj_t*));
+	if(!a){
+		fprintf(stderr,"ERROR: Array : could not grow %s to %d elements\n",obj_name(self),capacity);
+		return 0;
+	}
+	HEAP_RESIZE(HEAP_ARRAYS,self->capacity*sizeof(obj_t*),capacity*sizeof(obj_t*));
+	self->array = a;
+	self->capacity = capacity;
+	return 1;
+}
+/* drops the share of self in its storage, the last owner frees it */
+static void array_release(array_obj *self){
+	int i = self->length;
+	if(self->shared){
+		int owners = SYNC_DEC(*self->shared);
+		if(owners == 1){
+			gc_unshared(self->array,self->length);
+		}
+		if(owners){
+			return;
+		}
+		free(self->shared);
+	}
+	while(i--){
+		obj_unref(self->array[i]);
+	}
+	HEAP_FREE(HEAP_ARRAYS,self->capacity*sizeof(obj_t*));
+	free(self->array);
+}
+/* gives a cloned array storage of its own, returns 0 when out of memory */
+static int array_own(array_obj *self){
+	obj_t **a;
+	int i;
+	if(!self->shared){
+		return 1;
+	}else if(SYNC_LOAD(*self->shared) == 1){
+		free(self->shared);
+		self->shared = NULL;
+		return 1;
+	}
+	a = (obj_t**)malloc(self->capacity*sizeof(obj_t*));
+	if(!a){
+		fprintf(stderr,"ERROR: Array : could not copy %s\n",obj_name(self));
+		return 0;
+	}
+	HEAP_ALLOC(HEAP_ARRAYS,self->capacity*sizeof(obj_t*));
+	memcpy(a,self->array,self->length*sizeof(obj_t*));
+	for(i = 0; i < self->length; i++){
+		if(a[i]){
+			obj_ref(a[i]);
+		}
+	}
+	array_release(self);
+	self->array  = a;
+	self->shared = NULL;
+	return 1;
+}
+/* makes room for count more elements */
+static int array_room(array_obj *self, int count){
+	int capacity = self->capacity ? self->capacity : ARRAY_MIN;
+	while(capacity < self->length + count){
+		capacity *= 2;
+	}
+	return array_grow(self,capacity);
+}
 static obj_t* __array_constructor(obj_t *_self, va_list *app){
 	array_obj *self = (array_obj*)_self;
-	self->length = (int)(va_arg(*app,int));
-	self->array = (obj_t**)malloc(self->length*sizeof(obj_t*));
-	if(!self->array){
-		fprintf(stderr,"ERROR: obj_new(Array,...) could not allocate an Array of size %d\n",self->length);
-		free(self);
-		return NULL;
-	}else{
-		memset(self->array,0,self->length*sizeof(obj_t*));
+	int length = (int)(va_arg(*app,int));
+	self->length = 0;
+	self->capacity = 0;
+	self->array = NULL;
+	if(length > 0){
+		if(!array_grow(self,length)){
+			return NULL;
+		}
+		memset(self->array,0,length*sizeof(obj_t*));
+		self->length = length;
 	}
 	return _self;
 }
-static void __array_print(const obj_t *_self, FILE *file){
+static void __array_print(const obj_t *_self, writer_t *w){
 	array_obj *self = (array_obj*)_self;
 	if(!self->length){
-		fprintf(file,"[]");
+		writer_bytes(w,"[]",2);
 	}else{
 		int i = 0;
-		fprintf(file,"[");
+		writer_char(w,'[');
 		while(i < self->length){
-
-			//fprintf(file,"%s:%s ",f->key,obj(f->data)->name);
-			obj_printf(file,self->array[i]);
-			fprintf(file," ");
+			obj_write(w,self->array[i]);
+			writer_char(w,' ');
 			i++;
 		}
-		fprintf(file,"]");
+		writer_char(w,']');
 	}
 }
 static obj_t* __array_destructor(obj_t*_self){
+	array_release((array_obj*)_self);
+	return _self;
+}
+/* the clone shares the storage of self */
+static obj_t* __array_clone(obj_t *_self){
 	array_obj *self = (array_obj*)_self;
-	int i = self->length;
-	fprintf(stdout,"DESTR: Array:%s\n",obj(_self)->name);
-	while(i--){
-		obj_unref(self->array[i]);
+	array_obj *c;
+	if(self->array && !self->shared){
+		self->shared = (int*)malloc(sizeof(int));
+		if(!self->shared){
+			fprintf(stderr,"ERROR: obj_clone() : out of memory\n");
+			return NULL;
+		}
+		*self->shared = 1;
 	}
-	free(self->array);
-	return _self;
+	c = (array_obj*)obj_copy(_self);
+	if(c && c->shared){
+		SYNC_INC(*c->shared);
+	}
+	return c;
 }
 static int __array_equals(const obj_t *_self, const obj_t *_b){
-	fprintf(stdout,"TODO : implement Array Equals\n");
-	return 0;
+	const array_obj *self = (const array_obj*)_self;
+	const array_obj *b    = (const array_obj*)_b;
+	int i;
+	if(self->length != b->length || hash_differs(_self,self->hash,_b,b->hash)){
+		return 0;
+	}
+	for(i = 0; i < self->length; i++){
+		if(!obj_equals(self->array[i],b->array[i])){
+			return 0;
+		}
+	}
+	return 1;
 }
 static unsigned int __array_hash(const obj_t *_self){
-	fprintf(stdout,"TODO : implement Array Hash\n");
-	return 0;
+	array_obj *self = (array_obj*)_self;
+	unsigned int h;
+	int leaves;
+	if(hash_cached(_self)){
+		return self->hash;
+	}
+	h = sequence_hash(_self,&leaves);
+	return hash_store(_self,&self->hash,h,leaves);
 }
 static obj_t*  __array_get_index(const obj_t *_self,int index){
 	const array_obj *self = (array_obj*)_self;
@@ -935,9 +2516,14 @@ static obj_t*  __array_get_index(const obj_t *_self,int index){
 static void	__array_set_index(obj_t *_self,int index,obj_t *data){
 	array_obj *self = (array_obj*)_self;
 	if(index >= 0 && index < self->length){
-		obj_unref(self->array[index]);
-		self->array[index] = data; 
-		obj_ref(data);
+		obj_t *old;
+		if(!array_own(self)){
+			return;
+		}
+		old = self->array[index];
+		hash_invalidate(self);
+		self->array[index] = data ? obj_ref(data) : NULL;
+		obj_unref(old);
 		return;
 	}else{
 		fprintf(stderr,"ERROR: __array_set_index() : index %d out of range [0,%d[\n",index,self->length);
@@ -948,13 +2534,31 @@ static int __array_len(const obj_t *_self){
 	const array_obj *self = (array_obj*)_self;
 	return self->length;
 }
+static void	__array_append(obj_t *self, obj_t *data){
+	array_append(self,data);
+}
+static void	__array_rem_index(obj_t *self, int index){
+	array_remove(self,index);
+}
+static void __array_iterator(const obj_t *self, obj_iter_t *it){
+	it->kind = OBJ_ITER_REFS;
+}
+static void __array_traverse(obj_t *_self, obj_visit_t visit, void *ctx){
+	array_obj *self = (array_obj*)_self;
+	int i;
+	traverse_fields(_self,visit,ctx);
+	for(i = 0; (!self->shared || *self->shared == 1) && i < self->length; i++){
+		visit(&self->array[i],ctx);
+	}
+}
+static klass_info_t array_info;
 const klass_t array_klass = {
 	&object_klass,
 	sizeof(array_obj),
 	"Array",
 	__array_constructor,
 	__array_destructor,
-	NULL,
+	__array_clone,
 	__array_equals,
 	__array_print,
 	__array_hash,	
@@ -963,137 +2567,551 @@ const klass_t array_klass = {
 	__array_get_index,
 	NULL,	//set
 	__array_set_index,
-	NULL,	//append
+	__array_append,
 	NULL,	//rem
-	NULL,	//rem_index
+	__array_rem_index,
 	__array_len,
-	NULL	//iterator
+	__array_iterator,
+	__array_traverse,
+	&array_info	//info
 };
 const klass_t * Array = &array_klass;
 
-int main(int argc, char **argv){
-	obj_t *i1 = obj_new(Int,1);
-	obj_t *i2 = obj_new(Int,2);
-	obj_t *i3 = obj_new(Int,3);
-	obj_t *i4 = obj_new(Int,4);
-	obj_t *a = obj_new(Array,10);
-	obj_set_index(a,0,i1);
-	obj_printfn(stdout,a);
-	obj_unref(a);
-	return 0;
+static int is_array(obj_t *self, const char *fn){
+	if(self && obj_instance_of(self,Array)){
+		return 1;
+	}else{
+		fprintf(stderr,"ERROR: %s() : %s is not an Array\n",fn,self ? obj_name(self) : "NULL");
+		return 0;
+	}
 }
-/*int main(int argc, char **argv){
-	printf("LIST");
-	obj_t *i1 = obj_new(Int,1);
-	obj_t *i2 = obj_new(Int,2);
-	obj_t *i3 = obj_new(Int,3);
-	obj_t *i4 = obj_new(Int,4);
-	obj_t *l1 = obj_new(List);
-	printf("->append\n");
-	list_append(l1,i1);
-	list_append(l1,i2);
-	list_append(l1,i3);
-	list_append(l1,i4);
-	list_append(l1,tmp(obj_new(Float,3.14)));
-	obj_printfn(stdout,l1);
-	list_remove(l1,1);
-	list_set(l1,1,i4);
-	obj_printfn(stdout,l1);
-	printf("->unref is\n");
-	obj_unref(i1);
-	obj_unref(i2);
-	obj_unref(i3);
-	obj_unref(i4);
-	obj_printfn(stdout,l1);
-	printf("->unref ls\n");
-	obj_unref(l1);
 
-	printf("ARRAY");
-	i1 = obj_new(Int,1);
-	i2 = obj_new(Int,2);
-	i3 = obj_new(Int,3);
-	i4 = obj_new(Int,4);
-	obj_t* a1 = obj_new(Array,10);
-	array_set(a1,0,i1);
-	array_set(a1,2,i2);
-	array_set(a1,3,i3);
-	array_set(a1,9,i4);
-	array_set(a1,8,i4);
-	array_set(a1,7,i4);
-	array_set(a1,0,i4);
-	obj_printfn(stdout,a1);
-	obj_unref(i1);
-	obj_unref(i2);
-	obj_unref(i3);
-	obj_unref(i4);
-	obj_unref(a1);
+int	array_length(obj_t *_self){
+	if(!is_array(_self,"array_length")){
+		return 0;
+	}
+	return ((array_obj*)_self)->length;
+}
+obj_t*	array_get(obj_t *_self, int index){
+	if(!is_array(_self,"array_get")){
+		return NULL;
+	}
+	return __array_get_index(_self,index);
+}
+void	array_set(obj_t *_self, int index, obj_t *data){
+	if(!is_array(_self,"array_set")){
+		return;
+	}
+	__array_set_index(_self,index,data);
+}
+int	array_append(obj_t *_self, obj_t *data){
+	array_obj *self = (array_obj*)_self;
+	if(!is_array(_self,"array_append")){
+		return 0;
+	}
+	if(!array_own(self) || (self->length == self->capacity && !array_room(self,1))){
+		return self->length;
+	}
+	hash_invalidate(self);
+	self->array[self->length++] = data ? obj_ref(data) : NULL;
+	return self->length;
+}
+void	array_insert(obj_t *_self, int index, obj_t *data){
+	array_obj *self = (array_obj*)_self;
+	if(!is_array(_self,"array_insert")){
+		return;
+	}
+	if(index < 0 || index > self->length){
+		fprintf(stderr,"ERROR: array_insert() : index %d out of range [0,%d]\n",index,self->length);
+		return;
+	}else if(!array_own(self) || (self->length == self->capacity && !array_room(self,1))){
+		return;
+	}
+	hash_invalidate(self);
+	memmove(self->array + index + 1,self->array + index,(self->length - index)*sizeof(obj_t*));
+	self->array[index] = data ? obj_ref(data) : NULL;
+	self->length++;
+}
+void	array_remove(obj_t *_self, int index){
+	array_obj *self = (array_obj*)_self;
+	obj_t *old;
+	if(!is_array(_self,"array_remove")){
+		return;
+	}
+	if(index < 0 || index >= self->length){
+		fprintf(stderr,"ERROR: array_remove() : index %d out of range [0,%d[\n",index,self->length);
+		return;
+	}else if(!array_own(self)){
+		return;
+	}
+	old = self->array[index];
+	hash_invalidate(self);
+	memmove(self->array + index,self->array + index + 1,(self->length - index - 1)*sizeof(obj_t*));
+	self->length--;
+	obj_unref(old);
+}
+void	array_reserve(obj_t *_self, int capacity){
+	if(!is_array(_self,"array_reserve") || !array_own((array_obj*)_self)){
+		return;
+	}
+	array_grow((array_obj*)_self,capacity);
+}
+void	array_shrink_to_fit(obj_t *_self){
+	array_obj *self = (array_obj*)_self;
+	if(!is_array(_self,"array_shrink_to_fit") || !array_own(self)){
+		return;
+	}
+	if(!self->length){
+		HEAP_FREE(HEAP_ARRAYS,self->capacity*sizeof(obj_t*));
+		free(self->array);
+		self->array = NULL;
+		self->capacity = 0;
+	}else if(self->length < self->capacity){
+		obj_t **a = (obj_t**)realloc(self->array,self->length*sizeof(obj_t*));
+		if(a){
+			HEAP_RESIZE(HEAP_ARRAYS,self->capacity*sizeof(obj_t*),self->length*sizeof(obj_t*));
+			self->array = a;
+			self->capacity = self->length;
+		}
+	}
+}
+/* Appends the elements of an Array or a List, or data itself if it is
+ * neither. Array elements are copied in one memcpy, List elements one
+ * node at a time. */
+int	array_extend(obj_t *_self, obj_t *data){
+	array_obj *self = (array_obj*)_self;
+	int start, i;
+	if(!is_array(_self,"array_extend")){
+		return 0;
+	}else if(!array_own(self)){
+		return self->length;
+	}
+	start = self->length;
+	hash_invalidate(self);
+	if(data && obj_instance_of(data,Array)){
+		array_obj *a = (array_obj*)data;
+		int count = a->length;
+		if(!array_room(self,count)){
+			return self->length;
+		}
+		memcpy(self->array + self->length,a->array,count*sizeof(obj_t*));
+		self->length += count;
+	}else if(data && obj_instance_of(data,List)){
+		list_obj *l = (list_obj*)data;
+		node_t *n = l->first;
+		if(!array_room(self,l->length)){
+			return self->length;
+		}
+		while(n){
+			memcpy(self->array + self->length,n->chunk->data,n->count*sizeof(obj_t*));
+			self->length += n->count;
+			n = n->next;
+		}
+	}else{
+		return array_append(_self,data);
+	}
+	for(i = start; i < self->length; i++){
+		if(self->array[i]){
+			obj_ref(self->array[i]);
+		}
+	}
+	return self->length;
+}
+/* new Array holding the elements in [start,end[ */
+obj_t*	array_slice(obj_t *_self, int start, int end){
+	array_obj *self = (array_obj*)_self;
+	array_obj *slice;
+	int i;
+	if(!is_array(_self,"array_slice")){
+		return NULL;
+	}
+	if(start < 0 || end > self->length || start > end){
+		fprintf(stderr,"ERROR: array_slice() : [%d,%d[ out of range [0,%d[\n",start,end,self->length);
+		return NULL;
+	}
+	slice = (array_obj*)obj_new(Array,0);
+	if(!slice || !array_grow(slice,end - start)){
+		obj_unref(slice);
+		return NULL;
+	}
+	memcpy(slice->array,self->array + start,(end - start)*sizeof(obj_t*));
+	slice->length = end - start;
+	for(i = 0; i < slice->length; i++){
+		if(slice->array[i]){
+			obj_ref(slice->array[i]);
+		}
+	}
+	return slice;
+}
 
-	return 0;
-}*/
-/*
-int main(int argc, char **argv){
-	obj_printfn(stdout,obj_new(Int,1));
-	obj_printfn(stdout,obj_new(Int,-5));
-	obj_printfn(stdout,obj_new(Int,4092));
+/* 	TYPED ARRAYS	*/
+/* FloatArray and IntArray store their elements unboxed in one block, both
+ * element types being 4 bytes they share everything but boxing. Elements
+ * are boxed on demand by obj_get_index(), which allocates nothing when
+ * numbers are immediates and otherwise needs an open pool, see obj_box().
+ * floatarray_data() and intarray_data() give the storage itself to loops
+ * that do not want boxes at all. obj_new(FloatArray,n) creates n zeros. */
+#define TYPED_SIZE 4
 
-	obj_t *ht = obj_new(HashTable);
-	obj_printfn(stdout,ht);
-	hashtable_set(ht,"A",obj_new(Float,3.14));
-	hashtable_set(ht,"B",obj_new(Float,5.16));
-	hashtable_set(ht,"C",obj_new(Float,-9.98));
-	obj_printfn(stdout,ht);
+static int typedarray_grow(typedarray_obj *self, int capacity){
+	void *d;
+	if(capacity <= self->capacity){
+		return 1;
+	}
+	d = self->storage ? malloc(capacity*TYPED_SIZE) : realloc(self->data,capacity*TYPED_SIZE);
+	if(!d){
+		fprintf(stderr,"ERROR: %s : could not grow %s to %d elements\n",obj_klass(self)->name,obj_name(self),capacity);
+		return 0;
+	}
+	if(self->storage){
+		HEAP_ALLOC(HEAP_NUMBERS,capacity*TYPED_SIZE);
+		memcpy(d,self->data,self->length*TYPED_SIZE);
+		obj_unref(self->storage);
+		self->storage = NULL;
+	}else{
+		HEAP_RESIZE(HEAP_NUMBERS,self->capacity*TYPED_SIZE,capacity*TYPED_SIZE);
+	}
+	self->data = d;
+	self->capacity = capacity;
+	return 1;
+}
+static int typedarray_room(typedarray_obj *self, int count){
+	int capacity = self->capacity ? self->capacity : ARRAY_MIN;
+	while(capacity < self->length + count){
+		capacity *= 2;
+	}
+	return typedarray_grow(self,capacity);
+}
+static int is_typedarray(const obj_t *self, const klass_t *klass, const char *fn){
+	if(self && !obj_is_immediate(self) && obj_instance_of((obj_t*)self,klass)){
+		return 1;
+	}else{
+		fprintf(stderr,"ERROR: %s() : %s is not a %s\n",fn,self ? obj_name(self) : "NULL",klass->name);
+		return 0;
+	}
+}
+static obj_t* __typedarray_constructor(obj_t *_self, va_list *app){
+	typedarray_obj *self = (typedarray_obj*)_self;
+	int length = (int)(va_arg(*app,int));
+	if(length > 0){
+		if(!typedarray_grow(self,length)){
+			return NULL;
+		}
+		memset(self->data,0,length*TYPED_SIZE);
+		self->length = length;
+	}
+	return _self;
+}
+static obj_t* __typedarray_destructor(obj_t *_self){
+	typedarray_obj *self = (typedarray_obj*)_self;
+	if(self->storage){
+		obj_unref(self->storage);
+	}else{
+		HEAP_FREE(HEAP_NUMBERS,self->capacity*TYPED_SIZE);
+		free(self->data);
+	}
+	return _self;
+}
+/* the clone gets a copy of the data, borrowed data included */
+static obj_t* __typedarray_clone(obj_t *_self){
+	const typedarray_obj *self = (const typedarray_obj*)_self;
+	typedarray_obj *c = (typedarray_obj*)obj_copy(_self);
+	if(!c){
+		return NULL;
+	}
+	c->storage = NULL;
+	c->data = NULL;
+	c->capacity = 0;
+	if(self->length && !typedarray_grow(c,self->length)){
+		c->length = 0;
+		obj_unref(c);
+		return NULL;
+	}
+	memcpy(c->data,self->data,self->length*TYPED_SIZE);
+	return c;
+}
+static void __typedarray_print(const obj_t *_self, writer_t *w){
+	const typedarray_obj *self = (const typedarray_obj*)_self;
+	int i;
+	writer_char(w,'[');
+	for(i = 0; i < self->length; i++){
+		if(obj_instance_of((obj_t*)_self,FloatArray)){
+			writer_float(w,((float*)self->data)[i]);
+		}else{
+			writer_int(w,((int32_t*)self->data)[i]);
+		}
+		writer_char(w,' ');
+	}
+	writer_char(w,']');
+}
+static int __typedarray_len(const obj_t *_self){
+	return ((const typedarray_obj*)_self)->length;
+}
+static obj_t*  __typedarray_get_index(const obj_t *_self,int index){
+	const typedarray_obj *self = (const typedarray_obj*)_self;
+	if(index < 0 || index >= self->length){
+		fprintf(stderr,"ERROR: __typedarray_get_index() : index %d out of range [0,%d[\n",index,self->length);
+		return NULL;
+	}else if(obj_instance_of((obj_t*)_self,FloatArray)){
+		return obj_box(obj_new(Float,(double)((float*)self->data)[index]),"obj_get_index");
+	}else{
+		return obj_box(obj_new(Int,(int)((int32_t*)self->data)[index]),"obj_get_index");
+	}
+}
+static void	__typedarray_set_index(obj_t *_self,int index,obj_t *data){
+	typedarray_obj *self = (typedarray_obj*)_self;
+	if(index < 0 || index >= self->length){
+		fprintf(stderr,"ERROR: __typedarray_set_index() : index %d out of range [0,%d[\n",index,self->length);
+	}else if(obj_instance_of(_self,FloatArray)){
+		((float*)self->data)[index] = obj_float(data);
+	}else{
+		((int32_t*)self->data)[index] = obj_int(data);
+	}
+}
+static void	__typedarray_append(obj_t *_self, obj_t *data){
+	if(obj_instance_of(_self,FloatArray)){
+		floatarray_append(_self,obj_float(data));
+	}else{
+		intarray_append(_self,obj_int(data));
+	}
+}
+static void	__typedarray_rem_index(obj_t *_self, int index){
+	typedarray_obj *self = (typedarray_obj*)_self;
+	char *d = (char*)self->data;
+	if(index < 0 || index >= self->length){
+		fprintf(stderr,"ERROR: __typedarray_rem_index() : index %d out of range [0,%d[\n",index,self->length);
+		return;
+	}
+	memmove(d + index*TYPED_SIZE,d + (index + 1)*TYPED_SIZE,(self->length - index - 1)*TYPED_SIZE);
+	self->length--;
+}
+static void __typedarray_iterator(const obj_t *self, obj_iter_t *it){
+	it->kind = obj_instance_of((obj_t*)self,FloatArray) ? OBJ_ITER_FLOATS : OBJ_ITER_INTS;
+}
+static klass_info_t floatarray_info;
+const klass_t floatarray_klass = {
+	&object_klass,
+	sizeof(typedarray_obj),
+	"FloatArray",
+	__typedarray_constructor,
+	__typedarray_destructor,
+	__typedarray_clone,
+	NULL,	//equals
+	__typedarray_print,
+	NULL,	//hash
+	NULL,	//to
+	NULL,	//get
+	__typedarray_get_index,
+	NULL,	//set
+	__typedarray_set_index,
+	__typedarray_append,
+	NULL,	//rem
+	__typedarray_rem_index,
+	__typedarray_len,
+	__typedarray_iterator,
+	NULL,	//traverse
+	&floatarray_info	//info
+};
+const klass_t * FloatArray = &floatarray_klass;
 
-	obj_t *l = obj_new(List);
-	obj_printfn(stdout,l);
-	list_append(l,obj_new(Int,1));
-	list_append(l,obj_new(Int,2));
-	list_append(l,obj_new(Int,3));
-	list_append(l,obj_new(Int,4));
-	obj_printfn(stdout,l);
+static klass_info_t intarray_info;
+const klass_t intarray_klass = {
+	&object_klass,
+	sizeof(typedarray_obj),
+	"IntArray",
+	__typedarray_constructor,
+	__typedarray_destructor,
+	__typedarray_clone,
+	NULL,	//equals
+	__typedarray_print,
+	NULL,	//hash
+	NULL,	//to
+	NULL,	//get
+	__typedarray_get_index,
+	NULL,	//set
+	__typedarray_set_index,
+	__typedarray_append,
+	NULL,	//rem
+	__typedarray_rem_index,
+	__typedarray_len,
+	__typedarray_iterator,
+	NULL,	//traverse
+	&intarray_info	//info
+};
+const klass_t * IntArray = &intarray_klass;
 
-	obj_printfn(stdout,list_get(l,0));
-	obj_printfn(stdout,list_get(l,1));
-	obj_printfn(stdout,list_get(l,2));
-	obj_printfn(stdout,list_get(l,3));
+float*	floatarray_data(obj_t *self){
+	if(!is_typedarray(self,FloatArray,"floatarray_data")){
+		return NULL;
+	}
+	return (float*)((typedarray_obj*)self)->data;
+}
+int	floatarray_append(obj_t *_self, float value){
+	typedarray_obj *self = (typedarray_obj*)_self;
+	if(!is_typedarray(_self,FloatArray,"floatarray_append")){
+		return 0;
+	}
+	if(self->length == self->capacity && !typedarray_room(self,1)){
+		return self->length;
+	}
+	((float*)self->data)[self->length++] = value;
+	return self->length;
+}
+int32_t* intarray_data(obj_t *self){
+	if(!is_typedarray(self,IntArray,"intarray_data")){
+		return NULL;
+	}
+	return (int32_t*)((typedarray_obj*)self)->data;
+}
+int	intarray_append(obj_t *_self, int32_t value){
+	typedarray_obj *self = (typedarray_obj*)_self;
+	if(!is_typedarray(_self,IntArray,"intarray_append")){
+		return 0;
+	}
+	if(self->length == self->capacity && !typedarray_room(self,1)){
+		return self->length;
+	}
+	((int32_t*)self->data)[self->length++] = value;
+	return self->length;
+}
+/* new elements are zeroed, the storage is not released when shrinking */
+void	typedarray_resize(obj_t *_self, int length){
+	typedarray_obj *self = (typedarray_obj*)_self;
+	if(!self || obj_is_immediate(self) || (!obj_instance_of(_self,FloatArray) && !obj_instance_of(_self,IntArray))){
+		fprintf(stderr,"ERROR: typedarray_resize() : %s is not a typed array\n",self ? obj_name(self) : "NULL");
+		return;
+	}else if(length < 0){
+		fprintf(stderr,"ERROR: typedarray_resize() : negative length %d\n",length);
+		return;
+	}
+	if(length > self->length){
+		if(!typedarray_room(self,length - self->length)){
+			return;
+		}
+		memset((char*)self->data + self->length*TYPED_SIZE,0,(length - self->length)*TYPED_SIZE);
+	}
+	self->length = length;
+}
 
-	obj_t *l2 = obj_new(List);
-	list_append(l2,obj_new(Float,8.0));
-	list_append(l2,obj_new(Float,9.0));
-	list_append(l2,l);
-	obj_printfn(stdout,l2);
-	list_extend(l2,l);
-	obj_printfn(stdout,l2);
+/*	DEEP CLONES	*/
+/* deep clones map the handle slot of each original to its clone */
+typedef struct clone_map_s{
+	unsigned int	*handle;
+	obj_t		**clone;
+	int		length;
+	int		capacity;
+	obj_t		**queue;	/* clones whose references are not cloned yet */
+	int		queued;
+}clone_map_t;
 
-	obj_t *a1 = obj_new(Array,10);
-	obj_printfn(stdout,a1);
-	array_set(a1,0,obj_new(Float,1.0));
-	array_set(a1,4,obj_new(Float,4.0));
-	array_set(a1,5,obj_new(Float,5.0));
-	array_set(a1,9,obj_new(Float,9.0));
-	obj_printfn(stdout,a1);
-	obj_printfn(stdout,array_get(a1,0));
-	obj_printfn(stdout,array_get(a1,1));
-	obj_printfn(stdout,array_get(a1,9));
-	
-	return 0;
-}*/
-/*	
-int main(int argc, char **argv){
-	object_t* ob1 = obj_new(Object);
-	obj_set_field(ob1,"key1",obj_new(String,"1"));
-	obj_set_field(ob1,"key2",obj_new(String,"2"));
-	obj_set_field(ob1,"key3",obj_new(String,"3"));
-	obj_set_field(ob1,"key4",obj_new(String,"4"));
-	obj_set_field(ob1,"key5",obj_new(Float,5.62));
-	obj_set_field(ob1,"key6",obj_new(String,"6"));
-	obj_print(obj_set_field(ob1,"key1",obj_new(String,"1bis")),stdout);
-	obj_print(obj_set_field(ob1,"key2",obj_new(String,"2bis")),stdout);
-	obj_print(obj_set_field(ob1,"key3",obj_new(String,"3bis")),stdout);
-	obj_print(obj_get_field(ob1,"key4"),stdout);
-	obj_print(obj_get_field(ob1,"key5"),stdout);
-	obj_print(obj_get_field(ob1,"key6"),stdout);
-	obj_print(obj_get_field(ob1,"key1"),stdout);
-	obj_print(obj_get_field(ob1,"key2"),stdout);
-	obj_print(obj_get_field(ob1,"key3"),stdout);
-	return 0;
-}*/
+static obj_t **clone_map_slot(clone_map_t *m, unsigned int handle){
+	unsigned int i = obj_hash_finish(handle) & (m->capacity - 1);
+	while(m->handle[i] && m->handle[i] != handle){
+		i = (i + 1) & (m->capacity - 1);
+	}
+	m->handle[i] = handle;
+	return &m->clone[i];
+}
+static int clone_map_grow(clone_map_t *m){
+	int capacity = m->capacity ? m->capacity*2 : 64;
+	unsigned int *handle = (unsigned int*)calloc(capacity,sizeof(unsigned int));
+	obj_t **clone = (obj_t**)calloc(capacity,sizeof(obj_t*));
+	obj_t **queue = (obj_t**)realloc(m->queue,capacity*sizeof(obj_t*));
+	clone_map_t old = *m;
+	int i;
+	if(queue){
+		m->queue = queue;
+	}
+	if(!handle || !clone || !queue){
+		fprintf(stderr,"ERROR: obj_clone_deep() out of memory\n");
+		free(handle);
+		free(clone);
+		return 0;
+	}
+	m->handle = handle;
+	m->clone = clone;
+	m->capacity = capacity;
+	for(i = 0; i < old.capacity; i++){
+		if(old.handle[i]){
+			*clone_map_slot(m,old.handle[i]) = old.clone[i];
+		}
+	}
+	free(old.handle);
+	free(old.clone);
+	return 1;
+}
+/* the clone of o, made and queued the first time o is reached */
+static obj_t *clone_map_get(clone_map_t *m, obj_t *o){
+	obj_t **slot, *c;
+	if((m->length + 1)*2 > m->capacity && !clone_map_grow(m)){
+		return NULL;
+	}
+	slot = clone_map_slot(m,obj(o)->handle);
+	if(*slot){
+		return *slot;
+	}
+	c = obj_clone(o);
+	m->length++;
+	if(!c){
+		/* klasses that cannot be copied stay shared */
+		return *slot = obj_ref(o);
+	}
+	m->queue[m->queued++] = c;
+	return *slot = c;
+}
+static void clone_visit(obj_t **ref, void *ctx){
+	obj_t *old = *ref, *c;
+	if(hash_is_leaf(old)){
+		return;
+	}
+	c = clone_map_get((clone_map_t*)ctx,old);
+	if(c){
+		*ref = obj_ref(c);
+		obj_unref(old);
+	}
+}
+/* gives a clone storage of its own, so that its references can be changed */
+static void clone_own(obj_t *c){
+	fieldtable_own(obj(c));
+	if(obj_instance_of(c,List)){
+		node_t *n;
+		list_own((list_obj*)c);
+		for(n = ((list_obj*)c)->first; n; n = n->next){
+			node_own(n);
+		}
+	}else if(obj_instance_of(c,Array)){
+		array_own((array_obj*)c);
+	}
+}
+obj_t*		obj_clone_deep(const obj_t *self){
+	clone_map_t m;
+	obj_t *root;
+	int i;
+	if(!self){
+		return NULL;
+	}else if(hash_is_leaf(self)){
+		return obj_ref((obj_t*)self);
+	}
+	memset(&m,0,sizeof(clone_map_t));
+	root = clone_map_get(&m,(obj_t*)self);
+	while(m.queued){
+		obj_t *c = m.queue[--m.queued];
+		const klass_t *vt = obj_vt(c);
+		if(vt->traverse){
+			clone_own(c);
+			vt->traverse(c,clone_visit,&m);
+		}
+	}
+	if(root){
+		obj_ref(root);
+	}
+	for(i = 0; i < m.capacity; i++){
+		if(m.handle[i]){
+			obj_unref(m.clone[i]);
+		}
+	}
+	free(m.handle);
+	free(m.clone);
+	free(m.queue);
+	return root;
+}
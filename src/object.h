@@ -2,10 +2,23 @@
 #define __3DE_OBJECT_H__
 #include <stdio.h>
 #include <stdarg.h> 
+#include <stdint.h>
+#include "slab.h"
+#include "atom.h"
+#include "writer.h"
 
 typedef void obj_t;
 #define obj(x) ((object_t*)(x))
-#define NAME_LENGTH 16
+#define NAME_LENGTH 48
+
+#define KLASS_MAX_DEPTH 8
+#define KLASS_MAX	256
+
+struct klass_info_s;
+struct obj_iter_s;
+
+/* called by traverse() on each reference slot of an object */
+typedef void (*obj_visit_t)(obj_t **ref, void *ctx);
 
 typedef struct klass_s{
 	const struct klass_s * parent;
@@ -15,7 +28,7 @@ typedef struct klass_s{
 	obj_t* 		(*destructor)(obj_t *self);
 	obj_t* 		(*clone)(obj_t *self);
 	int    		(*equals)(const obj_t *self, const obj_t *b);
-	void   		(*print)(const  obj_t *self, FILE *f);
+	void   		(*print)(const  obj_t *self, writer_t *w);
 	unsigned int 	(*hash)(const obj_t *self);
 	obj_t*		(*to)(const obj_t *self, const struct klass_s *klass);
 
@@ -27,53 +40,235 @@ typedef struct klass_s{
 	void		(*rem)(obj_t *self, const char *path);
 	void		(*rem_index)(obj_t *self, int index);
 	int		(*len)(const obj_t *self);
-	obj_t*		(*iterator)(obj_t *self);
+	void		(*iterator)(const obj_t *self, struct obj_iter_s *it);
+	void		(*traverse)(obj_t *self, obj_visit_t visit, void *ctx);
+	struct klass_info_s *info;
 }klass_t;
 
+/* Mutable per klass runtime data. Every klass_t points to its own
+ * statically allocated klass_info_t, which starts zeroed and is filled by
+ * klass_register() the first time the klass is used.
+ * vt is a copy of the klass with every NULL method replaced by the one
+ * inherited from the closest ancestor, display[d] is the ancestor at
+ * depth d, so method lookup and instance_of tests never walk the parents. */
+typedef struct klass_info_s{
+	int		id;
+	int		depth;
+	const klass_t	*display[KLASS_MAX_DEPTH];
+	klass_t		vt;
+	int		ctor_count;
+	int		dtor_count;
+	obj_t*		(*ctor[KLASS_MAX_DEPTH])(obj_t *self, va_list *app);
+	obj_t*		(*dtor[KLASS_MAX_DEPTH])(obj_t *self);
+	slab_pool_t	pool;
+}klass_info_t;
+
+/* On 64 bit targets Int and Float values are not allocated: obj_new()
+ * returns an immediate obj_t* carrying the value in its upper 32 bits and
+ * a tag in its low bits, which are always zero in real object pointers.
+ * Immediates have no fields, no uid and are not refcounted, so obj_ref()
+ * and obj_unref() ignore them. Always go through obj_klass() and obj_int()
+ * or obj_float() rather than dereferencing an obj_t* that may be one. */
+#if UINTPTR_MAX > 0xffffffffu && !defined(OBJ_NO_IMMEDIATES)
+#define OBJ_IMMEDIATES
+#endif
+
+#define OBJ_TAG_BITS	2
+#define OBJ_TAG_MASK	3
+#define OBJ_TAG_INT	1
+#define OBJ_TAG_FLOAT	2
+
+#ifdef OBJ_IMMEDIATES
+#define obj_is_immediate(x) ((uintptr_t)(x) & OBJ_TAG_MASK)
+#define obj_klass(x) (obj_is_immediate(x) ? \
+		(((uintptr_t)(x) & OBJ_TAG_INT) ? &int_klass : &float_klass) : \
+		obj(x)->klass)
+#else
+#define obj_is_immediate(x) 0
+#define obj_klass(x) (obj(x)->klass)
+#endif
+
+#define obj_vt(x) (&(obj_klass(x)->info->vt))
+
+void		klass_register(const klass_t *klass);
+const klass_t*	klass_by_id(int id);
+
+/* Object fields live in an open addressing table with Robin Hood probing.
+ * The table is a single allocation, its length is a power of two and it
+ * doubles when it gets more than 3/4 full. Keys are atoms compared by
+ * pointer, their hash is copied in the slot. A NULL key marks a free slot. */
+#define FIELDTABLE_MIN 4
+
 typedef struct field_s{
-	char *key;
 	unsigned int hash;
+	const atom_t *key;
 	obj_t *data;
-	struct field_s *next;
 }field_t;
 
 typedef struct fieldtable_s{
 	int table_length;
 	int field_count;
-	field_t **table;
+	int owners;	/* objects sharing the table, see obj_clone() */
+	field_t table[];
 }fieldtable_t;
 
 extern const klass_t object_klass;
 extern const klass_t *Object;
 
+/* object_t.flags */
+#define OBJ_NAMED	0x1	/* has a name set by obj_set_name() */
+#define OBJ_LOCAL	0x2	/* owned by one thread, see obj_set_local() */
+#define OBJ_COLOR	0xc	/* cycle collector color, see gc.h */
+#define OBJ_BLACK	0x0
+#define OBJ_GRAY	0x4
+#define OBJ_WHITE	0x8
+#define OBJ_PURPLE	0xc
+#define OBJ_HASHED	0x10	/* the cached hash of a String or container is valid */
+
 typedef struct object_s{
 	const klass_t *klass;
-	unsigned int 	uid;
-	char 		name[NAME_LENGTH];
+	unsigned int 	handle;	/* slot in the handle table, see obj_uid() */
 	int		refcount;
 	int		flags;
+	int		root;	/* position + 1 in the cycle collector roots, or 0 */
 	fieldtable_t*	field;	
 }object_t;
 
 obj_t*		obj_new(const klass_t *klass, ... );
 void  		obj_free(obj_t *self);
+/* obj_clone() is O(1) for containers: the clone shares the field table,
+ * Array storage and List nodes of self and both copy what they share on
+ * their first write. A List then copies its node links but keeps sharing
+ * the elements of every node it has not written to. Elements are
+ * shared, not cloned. obj_clone_deep() clones every reachable object but
+ * Int, Float and String, which never change, and an object reached
+ * through several paths is cloned once.
+ * Cloning marks the storage of self as shared, it counts as a write to
+ * self when other threads use it.
+ * Klasses owning memory outside the instance implement clone on top of
+ * obj_copy(), a member-wise copy of self sharing its field table, and
+ * return NULL when they cannot be copied. */
 obj_t*		obj_clone(const obj_t *self);
+obj_t*		obj_clone_deep(const obj_t *self);
+obj_t*		obj_copy(const obj_t *self);
 int    		obj_equals(const obj_t *self, const obj_t *b);
 void   		obj_printf(FILE *f, const obj_t *self);
 void   		obj_printfn(FILE *f, const obj_t *self);
+/* print callbacks write their elements with obj_write(), obj_to_buffer()
+ * returns the printed text, NUL terminated, for the caller to free() */
+void		obj_write(writer_t *w, const obj_t *self);
+char*		obj_to_buffer(const obj_t *self, size_t *length);
 unsigned int 	obj_hash(const obj_t *self);
+/* Running hash for klass hash methods: start from any seed, combine each
+ * part in order and finish once. */
+static inline unsigned int obj_hash_combine(unsigned int h, unsigned int v){
+	h ^= v;
+	h *= 0x9e3779b1u;
+	return h ^ (h >> 15);
+}
+static inline unsigned int obj_hash_finish(unsigned int h){
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	return h ^ (h >> 16);
+}
 int		obj_instance_of(obj_t *self, const klass_t *k);
 obj_t*		obj_ref(obj_t *self);
 obj_t*		obj_unref(obj_t *self);
-obj_t*		tmp(obj_t *self);
-
 
+/* Autorelease pools. obj_autorelease() hands the caller's reference to
+ * the innermost pool of the thread, which releases all of its objects at
+ * once when obj_pool_pop() closes it. obj_pool_push_arena() also opens a
+ * frame arena for the pool, see obj_arena_begin(), for frames where none
+ * of the objects created escapes: the temporaries are released and then
+ * the memory of the whole frame is given back in bulk.
+ * tmp() autoreleases its object when a pool is open. Without a pool it
+ * only drops the reference without freeing, so an object that is never
+ * stored afterwards leaks. */
+void		obj_pool_push(void);
+void		obj_pool_push_arena(void);
+void		obj_pool_pop(void);
+obj_t*		obj_autorelease(obj_t *self);
+obj_t*		tmp(obj_t *self);
+/* Containers that store their elements unboxed hand out a new box from
+ * obj_get_index() and obj_iter_next(), which the innermost pool owns.
+ * Without an open pool the box could only leak: obj_box() reports it
+ * from fn, frees the box and returns NULL. Immediates need no pool. */
+obj_t*		obj_box(obj_t *box, const char *fn);
+
+/* With OBJ_THREADS refcounts are atomic. An object that only its
+ * creating thread touches can skip that cost: obj_set_local() switches
+ * its refcount back to plain increments, and obj_share() must be called
+ * before the object is handed to another thread. */
+void		obj_set_local(obj_t *self);
+obj_t*		obj_share(obj_t *self);
+
+/* Objects are allocated from per klass slab pools. Between
+ * obj_arena_begin() and obj_arena_end() they come from a frame arena
+ * instead, and the memory of every object created in it is released at
+ * once by obj_arena_end(). An arena object still live then keeps the
+ * whole arena until it is freed too. */
+void		obj_arena_begin(void);
+void		obj_arena_end(void);
+void		obj_alloc_report(FILE *f);
+const slab_pool_t* obj_alloc_stats(const klass_t *klass);
+
+/* Built with OBJ_GC, looks for garbage cycles among the possible roots
+ * recorded by obj_unref(), batch after batch until none is left or
+ * budget_us microseconds have passed, 0 meaning no limit. Batches are
+ * sized from the measured cost of a root to fit in the budget, but one
+ * root and everything it reaches is handled at once, so a root reaching
+ * a large graph can still overrun it: the budget bounds the number of
+ * roots taken, not the size of their graphs. Returns the number of
+ * objects freed, always 0 without OBJ_GC. */
+int		obj_gc_collect(int budget_us);
+int		obj_gc_pending(void);
+
+
+/* Names are not stored: obj_name() formats "<klass><uid>" on demand in
+ * one of a few rotating buffers, unless obj_set_name() gave the object an
+ * explicit name, which is kept in a side table. */
 const char*	obj_name(const obj_t *self);
-void		obj_set_name(obj_t *self);
-unsigned int	obj_uid(const obj_t *self);
+void		obj_set_name(obj_t *self, const char *name);
+
+/* Every live object holds a slot of a handle table and its uid names that
+ * slot: the low 32 bits are the slot index and the high 32 bits the
+ * generation of the slot, which changes each time the slot is reused.
+ * Uids are never 0 and never repeat, unless one slot goes through 2^32
+ * objects. At most 2^OBJ_HANDLE_BITS - 1 objects live at once, 2^24 - 1
+ * unless built otherwise; obj_new() reports an error and returns NULL
+ * past that. obj_by_uid() is a lookup and a compare and takes no lock, it
+ * returns NULL once the object is freed. The object it returns is
+ * borrowed; with OBJ_THREADS the caller must otherwise know that no other
+ * thread frees it meanwhile. */
+typedef uint64_t obj_uid_t;
+
+obj_uid_t	obj_uid(const obj_t *self);
+obj_t*		obj_by_uid(obj_uid_t uid);
+/* Calls visit on every live object, klass by klass and then the arenas,
+ * in the address order of their slabs. visit may create objects but must
+ * not free any; whether those it creates are visited is unspecified. With
+ * OBJ_THREADS no other thread may create or free objects meanwhile.
+ * Returns the number of objects visited, or -1 when out of memory. */
+int		obj_walk(void (*visit)(obj_t *self, void *ctx), void *ctx);
+
+/* Weak references. obj_weak() returns a handle on self that does not
+ * keep it alive, obj_weak_get() returns the object while it lives and
+ * NULL once it is freed. A handle carries the same slot and generation as
+ * the uid, laid out so that it never collides with an immediate.
+ * obj_weak_get() takes no lock and the object it returns is borrowed, as
+ * with obj_by_uid(). Immediates are their own handle and never expire,
+ * 0 is the handle of NULL. */
+typedef uint64_t obj_weak_t;
+
+obj_weak_t	obj_weak(obj_t *self);
+obj_t*		obj_weak_get(obj_weak_t weak);
 
 void		obj_set_field(obj_t *self, const char *field, obj_t *value);
 obj_t*		obj_get_field(const obj_t *self, const char *field);
+void		obj_set_field_atom(obj_t *self, const atom_t *field, obj_t *value);
+obj_t*		obj_get_field_atom(const obj_t *self, const atom_t *field);
 
 obj_t*		obj_get(const obj_t *self,const char *path);
 obj_t*		obj_get_index(const obj_t *self,int index);
@@ -86,10 +281,77 @@ void		obj_extend(obj_t *self,obj_t* data);
 void		obj_rem(obj_t *self, const char *path);
 void		obj_rem_index(obj_t *self, int index);
 
-obj_t*		obj_iterator(obj_t *self);
 int		obj_len(const obj_t *self);
 obj_t*		obj_to(const obj_t *self,const klass_t *klass);
 
+/* Iterators live on the stack. obj_iterator() dispatches once to fill
+ * one in, then each step is a switch on its kind, so walking a container
+ * allocates nothing. The elements of a List or an Array are borrowed,
+ * those of typed arrays are boxed in the open pool, see obj_box(), an Object
+ * yields the values of its fields and leaves the key of the last one in
+ * it->key. A container must not change while it is iterated.
+ *
+ *	obj_iter_t it;
+ *	obj_t *v;
+ *	obj_for_each(it,v,list){
+ *		...
+ *	}
+ *
+ * obj_iter_next_n() hands out the elements by contiguous spans of at most
+ * max elements instead, without boxing them. The span type depends on the
+ * kind: obj_t* for OBJ_ITER_REFS and OBJ_ITER_LIST, field_t for
+ * OBJ_ITER_FIELDS (every span entry has a key), float for OBJ_ITER_FLOATS
+ * and int32_t for OBJ_ITER_INTS. OBJ_ITER_INDEX has no storage to point
+ * at and never yields a span. */
+enum{
+	OBJ_ITER_END,
+	OBJ_ITER_REFS,		/* Array */
+	OBJ_ITER_LIST,		/* List nodes */
+	OBJ_ITER_FIELDS,	/* field table */
+	OBJ_ITER_FLOATS,	/* FloatArray */
+	OBJ_ITER_INTS,		/* IntArray */
+	OBJ_ITER_INDEX		/* obj_len() and obj_get_index() */
+};
+
+typedef struct obj_iter_s{
+	int		kind;
+	const obj_t	*self;
+	int		index;		/* next element */
+	const void	*node;		/* current List node */
+	int		slot;		/* next slot in the node or field table */
+	const atom_t	*key;		/* OBJ_ITER_FIELDS only */
+}obj_iter_t;
+
+void		obj_iterator(const obj_t *self, obj_iter_t *it);
+void		obj_iter_index(const obj_t *self, obj_iter_t *it);
+int		obj_iter_next(obj_iter_t *it, obj_t **value);
+int		obj_iter_next_n(obj_iter_t *it, const void **span, int max);
+
+#define obj_for_each(it,value,self) \
+	for(obj_iterator((self),&(it)); obj_iter_next(&(it),&(value)); )
+
+/* A compiled "a/b/c" path: its segments are interned once, resolving it
+ * allocates nothing and hashes nothing. The _cached variants also
+ * remember in the path where each segment was last found, a path kept
+ * at a call site then resolves repeated lookups without probing. */
+typedef struct obj_path_segment_s{
+	const atom_t		*key;
+	const fieldtable_t	*table;
+	int			slot;
+}obj_path_segment_t;
+
+typedef struct obj_path_s{
+	int			length;
+	obj_path_segment_t	segment[];
+}obj_path_t;
+
+obj_path_t*	obj_path_compile(const char *path);
+void		obj_path_free(obj_path_t *path);
+obj_t*		obj_path_get(const obj_t *self, const obj_path_t *path);
+void		obj_path_set(obj_t *self, const obj_path_t *path, obj_t *data);
+obj_t*		obj_path_get_cached(const obj_t *self, obj_path_t *path);
+void		obj_path_set_cached(obj_t *self, obj_path_t *path, obj_t *data);
+
 const char*	obj_string(const obj_t *self);
 int		obj_int(const obj_t *self);
 float		obj_float(const obj_t *self);
@@ -99,12 +361,25 @@ float		obj_float(const obj_t *self);
 extern const klass_t string_klass;
 extern const klass_t *String;
 
+/* Strings shorter than STRING_INLINE bytes are stored in the object. The
+ * hash is computed on first use and cached. */
+#define STRING_INLINE 32
+
 typedef struct string_s{
 	object_t ___;
 	char *text;
 	int  text_length;
+	unsigned int hash;
+	const atom_t *atom;	/* when set, text is the atom's storage */
+	obj_t	*storage;	/* when set, text is borrowed from it */
+	char	inline_text[STRING_INLINE];
 }string_obj;
 
+obj_t*		string_from_atom(const atom_t *a);
+/* length bytes of text, which needs no terminating NUL */
+obj_t*		string_from_text(const char *text, int length);
+const atom_t*	string_atom(obj_t *self);
+
 extern const klass_t float_klass;
 extern const klass_t *Float;
 
@@ -124,8 +399,14 @@ typedef struct int_s{
 extern const klass_t hashtable_klass;
 extern const klass_t *HashTable;
 
+/* Lists, Arrays and HashTables are equal when their elements are, field
+ * order aside for HashTables. Their hash is cached while OBJ_HASHED is set,
+ * which every mutation clears; it is only kept when no element is itself a
+ * container, as a mutation inside an element would go unnoticed. A
+ * container must not contain itself to be compared or hashed. */
 typedef struct hashtable_s{
 	object_t ___;
+	unsigned int hash;
 }hashtable_obj;
 
 void	hashtable_set(obj_t *self, const char *key, obj_t *value);
@@ -134,9 +415,19 @@ obj_t*  hashtable_get(obj_t *self, const char *key);
 extern const klass_t list_klass;
 extern const klass_t *List;
 
+#define LIST_NODE_LENGTH 32
+
+/* the elements of a node, shared by the nodes of cloned lists */
+typedef struct chunk_s{
+	int owners;
+	obj_t *data[LIST_NODE_LENGTH];
+}chunk_t;
+
 typedef struct node_s{
-	obj_t *data;
 	struct node_s *next;
+	struct node_s *prev;
+	int count;
+	chunk_t *chunk;
 }node_t;
 
 typedef struct list_s{
@@ -146,6 +437,8 @@ typedef struct list_s{
 	node_t *last;
 	node_t *current;
 	int	current_index;
+	unsigned int hash;
+	int	*shared;	/* owner count of the nodes when cloned */
 }list_obj;
 
 int	list_length(obj_t *list);
@@ -156,14 +449,47 @@ void	list_remove(obj_t *list, int index);
 int	list_append(obj_t *list, obj_t *data);
 int	list_extend(obj_t *list,  obj_t *list2);
 
+extern const klass_t array_klass;
+extern const klass_t *Array;
+
 typedef struct array_s{
 	object_t ___;
 	int length;
+	int capacity;
 	obj_t **array;
+	unsigned int hash;
+	int	*shared;	/* owner count of array when cloned */
 }array_obj;
 
 int	array_length(obj_t *list);
 void	array_set(obj_t *self, int index, obj_t *data);
 obj_t*	array_get(obj_t *self, int index);
+int	array_append(obj_t *self, obj_t *data);
+void	array_insert(obj_t *self, int index, obj_t *data);
+void	array_remove(obj_t *self, int index);
+void	array_reserve(obj_t *self, int capacity);
+void	array_shrink_to_fit(obj_t *self);
+int	array_extend(obj_t *self, obj_t *data);
+obj_t*	array_slice(obj_t *self, int start, int end);
+
+/* FloatArray and IntArray hold unboxed 32 bit numbers */
+extern const klass_t floatarray_klass;
+extern const klass_t *FloatArray;
+extern const klass_t intarray_klass;
+extern const klass_t *IntArray;
+
+typedef struct typedarray_s{
+	object_t ___;
+	int length;
+	int capacity;
+	void *data;	/* float[] or int32_t[] */
+	obj_t *storage;	/* when set, data is borrowed from it, copied on growth */
+}typedarray_obj;
+
+float*	floatarray_data(obj_t *self);
+int	floatarray_append(obj_t *self, float value);
+int32_t* intarray_data(obj_t *self);
+int	intarray_append(obj_t *self, int32_t value);
+void	typedarray_resize(obj_t *self, int length);
 
 #endif
@@ -0,0 +1,538 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "object.h"
+#include "vector.h"
+#include "parser.h"
+
+enum{
+	P_VALUE,	/* expecting a value */
+	P_KEY,		/* in a table, expecting a key or } */
+	P_KEYTOK,	/* in a key split by the end of a chunk */
+	P_STRING,	/* in a string, the text so far is in tok */
+	P_NUMBER,	/* in a number split by the end of a chunk */
+	P_WORD,		/* in a word split by the end of a chunk */
+	P_ERROR
+};
+enum{
+	F_ARRAY,
+	F_TABLE,
+	F_VEC
+};
+
+typedef struct frame_s{
+	int		kind;
+	obj_t		*obj;		/* Array or HashTable */
+	const atom_t	*key;		/* table key waiting for its value */
+	int		n;		/* vector components so far */
+	int		rows;		/* a vector holding rows is a matrix */
+	float		v[16];
+}frame_t;
+
+struct parser_s{
+	parser_fn	fn;
+	void		*ctx;
+	int		state;
+	int		escape;		/* P_STRING, after a backslash */
+	frame_t		*stack;
+	int		depth;
+	int		capacity;
+	char		*tok;		/* token split across chunks */
+	size_t		tok_length;
+	size_t		tok_capacity;
+	size_t		offset;		/* bytes fed before the current chunk */
+	char		error[96];
+};
+
+static const unsigned char DELIM[256] = {
+	[' '] = 1, ['\t'] = 1, ['\n'] = 1, ['\r'] = 1,
+	['['] = 1, [']'] = 1, ['{'] = 1, ['}'] = 1,
+	['<'] = 1, ['>'] = 1, ['"'] = 1
+};
+#define is_space(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
+
+parser_t*	parser_new(parser_fn fn, void *ctx){
+	parser_t *p = (parser_t*)calloc(1,sizeof(parser_t));
+	if(!p){
+		fprintf(stderr,"ERROR: parser_new() out of memory\n");
+		return NULL;
+	}
+	p->fn = fn;
+	p->ctx = ctx;
+	return p;
+}
+void		parser_free(parser_t *p){
+	if(!p){
+		return;
+	}
+	while(p->depth){
+		obj_unref(p->stack[--p->depth].obj);
+	}
+	free(p->stack);
+	free(p->tok);
+	free(p);
+}
+const char*	parser_error(const parser_t *p){
+	return p->state == P_ERROR ? p->error : NULL;
+}
+static int fail(parser_t *p, size_t at, const char *msg){
+	snprintf(p->error,sizeof(p->error),"%s at byte %lu",msg,(unsigned long)(p->offset + at));
+	p->state = P_ERROR;
+	return 0;
+}
+static int tok_append(parser_t *p, const char *s, size_t length){
+	if(p->tok_length + length > p->tok_capacity){
+		size_t capacity = p->tok_capacity ? p->tok_capacity : 64;
+		char *t;
+		while(capacity < p->tok_length + length){
+			capacity *= 2;
+		}
+		t = (char*)realloc(p->tok,capacity);
+		if(!t){
+			fprintf(stderr,"ERROR: parser_feed() out of memory\n");
+			return 0;
+		}
+		p->tok = t;
+		p->tok_capacity = capacity;
+	}
+	memcpy(p->tok + p->tok_length,s,length);
+	p->tok_length += length;
+	return 1;
+}
+
+/*	NUMBERS		*/
+/* Eight digits at once in a 64 bit word, on little endian targets. */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SWAR_DIGITS
+static int is_eight_digits(uint64_t v){
+	return !(((v & 0xF0F0F0F0F0F0F0F0ULL) | (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))
+		^ 0x3333333333333333ULL);
+}
+static uint32_t eight_digits(uint64_t v){
+	const uint64_t mask = 0x000000FF000000FFULL;
+	const uint64_t mul1 = 0x000F424000000064ULL;	/* 100 + (1000000 << 32) */
+	const uint64_t mul2 = 0x0000271000000001ULL;	/* 1 + (10000 << 32) */
+	v -= 0x3030303030303030ULL;
+	v = v*10 + (v >> 8);
+	return (uint32_t)(((v & mask)*mul1 + ((v >> 16) & mask)*mul2) >> 32);
+}
+#endif
+
+static const double POW10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* reads digits into *m, returns how many, at most 19 fit in *m */
+static size_t digits(const char *s, size_t length, uint64_t *m){
+	size_t i = 0;
+#ifdef SWAR_DIGITS
+	while(i + 8 <= length){
+		uint64_t v;
+		memcpy(&v,s + i,8);
+		if(!is_eight_digits(v)){
+			break;
+		}
+		*m = *m*100000000 + eight_digits(v);
+		i += 8;
+	}
+#endif
+	while(i < length && s[i] >= '0' && s[i] <= '9'){
+		*m = *m*10 + (s[i] - '0');
+		i++;
+	}
+	return i;
+}
+/* Numbers whose mantissa is at most 2^53 and exponent at most 22 in
+ * magnitude are exact as doubles before the one scaling, which then
+ * rounds correctly: those are read by hand, anything else goes through
+ * strtod(). */
+#define EXACT_MANTISSA	((uint64_t)1 << 53)
+static int parse_number(const char *s, size_t length, double *value, int *integral){
+	const char *end = s + length;
+	uint64_t m = 0;
+	size_t n, total;
+	int neg = 0, exp = 0;
+	char buf[64], *stop;
+	*integral = 1;
+	if(s < end && (*s == '-' || *s == '+')){
+		neg = *s++ == '-';
+	}
+	total = n = digits(s,end - s,&m);
+	s += n;
+	if(s < end && *s == '.'){
+		s++;
+		n = digits(s,end - s,&m);
+		s += n;
+		total += n;
+		exp = -(int)n;
+		*integral = 0;
+	}
+	if(s < end && (*s == 'e' || *s == 'E')){
+		int eneg = 0, e = 0;
+		s++;
+		if(s < end && (*s == '-' || *s == '+')){
+			eneg = *s++ == '-';
+		}
+		if(s == end){
+			return 0;
+		}
+		while(s < end && *s >= '0' && *s <= '9' && e < 10000){
+			e = e*10 + (*s++ - '0');
+		}
+		exp += eneg ? -e : e;
+		*integral = 0;
+	}
+	if(s == end && total > 0 && total <= 19 && m <= EXACT_MANTISSA && exp >= -22 && exp <= 22){
+		*value = exp < 0 ? (double)m/POW10[-exp] : (double)m*POW10[exp];
+		if(neg){
+			*value = -*value;
+		}
+		return 1;
+	}
+	/* nan, inf, long mantissas, large exponents */
+	if(length >= sizeof(buf)){
+		return 0;
+	}
+	memcpy(buf,end - length,length);
+	buf[length] = '\0';
+	*value = strtod(buf,&stop);
+	*integral = 0;
+	return stop == buf + length;
+}
+
+/*	VALUES		*/
+/* a container opened at byte at, fails the parse when it cannot be */
+static int push(parser_t *p, size_t at, int kind, obj_t *obj){
+	frame_t *f;
+	if(kind != F_VEC && !obj){
+		return fail(p,at,"out of memory");
+	}else if(p->depth == PARSER_MAX_DEPTH){
+		obj_unref(obj);
+		return fail(p,at,"nested too deep");
+	}else if(p->depth == p->capacity){
+		int capacity = p->capacity ? p->capacity*2 : 16;
+		frame_t *s = (frame_t*)realloc(p->stack,capacity*sizeof(frame_t));
+		if(!s){
+			obj_unref(obj);
+			return fail(p,at,"out of memory");
+		}
+		p->stack = s;
+		p->capacity = capacity;
+	}
+	f = &p->stack[p->depth++];
+	f->kind = kind;
+	f->obj = obj;
+	f->key = NULL;
+	f->n = 0;
+	f->rows = 0;
+	return 1;
+}
+/* takes the reference to value */
+static int emit(parser_t *p, size_t at, obj_t *value){
+	frame_t *top = p->depth ? &p->stack[p->depth - 1] : NULL;
+	if(!top){
+		p->fn(value,p->ctx);
+		p->state = P_VALUE;
+	}else if(top->kind == F_ARRAY){
+		array_append(top->obj,value);
+		obj_unref(value);
+		p->state = P_VALUE;
+	}else if(top->kind == F_TABLE){
+		obj_set_field_atom(top->obj,top->key,value);
+		obj_unref(value);
+		top->key = NULL;
+		p->state = P_KEY;
+	}else{
+		obj_unref(value);
+		return fail(p,at,"vectors only hold numbers");
+	}
+	return 1;
+}
+static int emit_number(parser_t *p, size_t at, const char *s, size_t length){
+	frame_t *top = p->depth ? &p->stack[p->depth - 1] : NULL;
+	double d;
+	int integral;
+	if(!parse_number(s,length,&d,&integral)){
+		return fail(p,at,"invalid number");
+	}
+	if(top && top->kind == F_VEC){
+		if(top->n == (top->rows ? 16 : 4)){
+			return fail(p,at,"too many vector components");
+		}
+		top->v[top->n++] = (float)d;
+		return 1;
+	}else if(integral && d >= -2147483648.0 && d <= 2147483647.0){
+		return emit(p,at,obj_new(Int,(int)d));
+	}else{
+		return emit(p,at,obj_new(Float,d));
+	}
+}
+/* object:Name, a generated name (Object<uid>) is not kept: it names an
+ * object of the writer, the new one generates its own */
+static int emit_object(parser_t *p, size_t at, const char *name, size_t length){
+	obj_t *o = obj_new(Object);
+	const atom_t *a = NULL;
+	size_t i = 6;
+	int generated = length > 6 && !memcmp(name,"Object",6);
+	while(generated && i < length){
+		generated = name[i] >= '0' && name[i] <= '9';
+		i++;
+	}
+	if(!o || (!generated && !(a = atom_len(name,(int)length)))){
+		obj_unref(o);
+		return fail(p,at,"out of memory");
+	}
+	if(a){
+		obj_set_name(o,a->text);
+	}
+	return emit(p,at,o);
+}
+static int emit_word(parser_t *p, size_t at, const char *s, size_t length){
+	if(length == 4 && !memcmp(s,"NULL",4)){
+		return emit(p,at,NULL);
+	}else if(length > 7 && !memcmp(s,"object:",7)){
+		return emit_object(p,at,s + 7,length - 7);
+	}else if((*s >= '0' && *s <= '9') || *s == '-' || *s == '+' || *s == '.'
+		|| (length == 3 && (!memcmp(s,"nan",3) || !memcmp(s,"inf",3)))){
+		return emit_number(p,at,s,length);
+	}
+	return fail(p,at,"unknown word");
+}
+static int emit_string(parser_t *p, size_t at, const char *s, size_t length){
+	obj_t *str = string_from_text(s,(int)length);
+	if(!str){
+		return fail(p,at,"out of memory");
+	}
+	return emit(p,at,str);
+}
+static int close_vec(parser_t *p, size_t at){
+	frame_t f = p->stack[--p->depth];
+	frame_t *top = p->depth ? &p->stack[p->depth - 1] : NULL;
+	if(top && top->kind == F_VEC){
+		/* a row of the enclosing matrix */
+		if(f.rows || f.n != 4 || top->n > 12 || (top->n && !top->rows)){
+			return fail(p,at,"matrix rows hold 4 numbers");
+		}
+		memcpy(top->v + top->n,f.v,4*sizeof(float));
+		top->n += 4;
+		top->rows++;
+		p->state = P_VALUE;
+		return 1;
+	}else if(f.rows){
+		mat4_t m;
+		if(f.rows != 4){
+			return fail(p,at,"matrices have 4 rows");
+		}
+		memcpy(&m,f.v,sizeof(mat4_t));
+		return emit(p,at,obj_new(Mat,&m));
+	}else if(f.n < 3){
+		return fail(p,at,"vectors have 3 or 4 components");
+	}
+	return emit(p,at,obj_new(Vec,(double)f.v[0],(double)f.v[1],(double)f.v[2],(double)(f.n == 4 ? f.v[3] : 0.0f)));
+}
+
+/* Scans a string from s, which follows the opening quote or an earlier
+ * part. Returns the bytes consumed, the closing quote included, and
+ * leaves the state at P_STRING if the chunk ended first. */
+static size_t scan_string(parser_t *p, const char *s, size_t length, size_t at, int fresh){
+	size_t i = 0;
+	if(fresh){
+		/* fast path: the whole string is in the chunk, without escapes */
+		const char *q = memchr(s,'"',length);
+		if(q && !memchr(s,'\\',q - s)){
+			emit_string(p,at,s,q - s);
+			return q - s + 1;
+		}
+		p->tok_length = 0;
+		p->escape = 0;
+		p->state = P_STRING;
+	}
+	while(i < length){
+		char c = s[i++];
+		if(p->escape){
+			c = c == 'n' ? '\n' : c == 't' ? '\t' : c;
+			p->escape = 0;
+		}else if(c == '\\'){
+			p->escape = 1;
+			continue;
+		}else if(c == '"'){
+			p->state = P_VALUE;
+			emit_string(p,at + i,p->tok,p->tok_length);
+			p->tok_length = 0;
+			return i;
+		}
+		if(!tok_append(p,&c,1)){
+			fail(p,at + i,"out of memory");
+			return length;
+		}
+	}
+	return i;
+}
+
+int		parser_feed(parser_t *p, const char *data, size_t length){
+	size_t i = 0;
+	while(i < length && p->state != P_ERROR){
+		char c = data[i];
+		size_t j;
+		switch(p->state){
+		case P_STRING:
+			i += scan_string(p,data + i,length - i,i,0);
+			continue;
+		case P_NUMBER:
+		case P_WORD:
+		case P_KEYTOK:
+			/* continue the split token up to its end */
+			j = i;
+			if(p->state == P_KEYTOK){
+				while(j < length && data[j] != ':' && !DELIM[(unsigned char)data[j]]){
+					j++;
+				}
+				if(j < length && data[j] != ':'){
+					return fail(p,j,"missing :");
+				}
+			}else{
+				while(j < length && !DELIM[(unsigned char)data[j]]){
+					j++;
+				}
+			}
+			if(!tok_append(p,data + i,j - i)){
+				return fail(p,i,"out of memory");
+			}
+			if(j == length){
+				i = j;
+				continue;
+			}
+			if(p->state == P_KEYTOK){
+				p->stack[p->depth - 1].key = atom_len(p->tok,p->tok_length);
+				p->state = P_VALUE;
+				j++;
+			}else if(p->state == P_NUMBER || p->state == P_WORD){
+				p->state = P_VALUE;
+				emit_word(p,j,p->tok,p->tok_length);
+			}
+			p->tok_length = 0;
+			i = j;
+			continue;
+		case P_KEY:
+			if(is_space(c)){
+				i++;
+			}else if(c == '}'){
+				obj_t *table = p->stack[--p->depth].obj;
+				i++;
+				emit(p,i,table);
+			}else{
+				j = i;
+				while(j < length && data[j] != ':' && !DELIM[(unsigned char)data[j]]){
+					j++;
+				}
+				if(j == length){
+					p->tok_length = 0;
+					p->state = P_KEYTOK;
+				}else if(data[j] != ':'){
+					return fail(p,j,"missing :");
+				}else{
+					p->stack[p->depth - 1].key = atom_len(data + i,j - i);
+					p->state = P_VALUE;
+					i = j + 1;
+				}
+			}
+			continue;
+		case P_VALUE:
+			break;
+		}
+		/* P_VALUE */
+		if(is_space(c)){
+			i++;
+		}else if(c == '['){
+			if(!push(p,i,F_ARRAY,obj_new(Array,0))){
+				return 0;
+			}
+			i++;
+		}else if(c == '{'){
+			if(!push(p,i,F_TABLE,obj_new(HashTable))){
+				return 0;
+			}
+			p->state = P_KEY;
+			i++;
+		}else if(c == '<'){
+			if(!push(p,i,F_VEC,NULL)){
+				return 0;
+			}
+			i++;
+		}else if(c == ']'){
+			if(!p->depth || p->stack[p->depth - 1].kind != F_ARRAY){
+				return fail(p,i,"unexpected ]");
+			}
+			i++;
+			p->depth--;
+			emit(p,i,p->stack[p->depth].obj);
+		}else if(c == '>'){
+			if(!p->depth || p->stack[p->depth - 1].kind != F_VEC){
+				return fail(p,i,"unexpected >");
+			}
+			i++;
+			close_vec(p,i);
+		}else if(c == '"'){
+			i++;
+			i += scan_string(p,data + i,length - i,i,1);
+		}else if(c == '}'){
+			return fail(p,i,"missing value");
+		}else{
+			/* number or word, parsed in place when it ends in this chunk */
+			j = i;
+			while(j < length && !DELIM[(unsigned char)data[j]]){
+				j++;
+			}
+			if(j < length){
+				emit_word(p,i,data + i,j - i);
+			}else{
+				p->tok_length = 0;
+				if(!tok_append(p,data + i,j - i)){
+					return fail(p,i,"out of memory");
+				}
+				p->state = (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ? P_NUMBER : P_WORD;
+			}
+			i = j;
+		}
+	}
+	p->offset += length;
+	return p->state != P_ERROR;
+}
+int		parser_end(parser_t *p){
+	if(p->state == P_NUMBER || p->state == P_WORD){
+		p->state = P_VALUE;
+		emit_word(p,0,p->tok,p->tok_length);
+		p->tok_length = 0;
+	}
+	if(p->state == P_ERROR){
+		return 0;
+	}else if(p->depth || p->state != P_VALUE){
+		return fail(p,0,"unexpected end");
+	}
+	return 1;
+}
+
+static void keep_first(obj_t *value, void *ctx){
+	obj_t **first = (obj_t**)ctx;
+	if(!*first){
+		*first = value;
+	}else{
+		obj_unref(value);
+	}
+}
+obj_t*		parser_parse(const char *text){
+	obj_t *first = NULL;
+	parser_t *p = parser_new(keep_first,&first);
+	if(!p){
+		return NULL;
+	}
+	if(!parser_feed(p,text,strlen(text)) || !parser_end(p)){
+		fprintf(stderr,"ERROR: parser_parse() : %s\n",parser_error(p));
+		obj_unref(first);
+		first = NULL;
+	}
+	parser_free(p);
+	return first;
+}
@@ -0,0 +1,39 @@
+#ifndef __3DE_PARSER_H__
+#define __3DE_PARSER_H__
+#include <stddef.h>
+#include "object.h"
+
+/* Reads back the syntax written by obj_printf():
+ *	[a b c]		Array
+ *	{key:val ...}	HashTable
+ *	"text"		String, \" \\ \n and \t are unescaped
+ *	12 -3.5 1e9	Int when integral and in range, Float otherwise
+ *	<x y z w>	Vec
+ *	<<...> ...>>	Mat, four rows of four
+ *	NULL		NULL
+ *	object:Name	a new Object without fields, named Name unless it
+ *			is a generated name (Object<uid>)
+ * The parser is pushed the text chunk by chunk, a chunk may end anywhere,
+ * and calls fn with each complete top level value, so a stream of values
+ * never needs to be in memory at once. fn receives a reference it must
+ * release. Tokens are parsed in place in the chunk, only those split by a
+ * chunk boundary are copied. */
+
+typedef void (*parser_fn)(obj_t *value, void *ctx);
+
+typedef struct parser_s parser_t;
+
+parser_t*	parser_new(parser_fn fn, void *ctx);
+void		parser_free(parser_t *p);
+
+/* Containers nest at most PARSER_MAX_DEPTH deep. Both return 0 once a
+ * syntax error was found, or memory ran out, see parser_error() */
+#define PARSER_MAX_DEPTH 4096
+int		parser_feed(parser_t *p, const char *data, size_t length);
+int		parser_end(parser_t *p);
+const char*	parser_error(const parser_t *p);
+
+/* parses the first value of a NUL terminated text */
+obj_t*		parser_parse(const char *text);
+
+#endif
@@ -0,0 +1,675 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "object.h"
+#include "vector.h"
+#include "serial.h"
+
+#define PAD8(x)	(((x) + 7) & ~(uint64_t)7)
+#define REF_OBJECT	((uint64_t)1 << 63)	/* map keys of objects by handle slot, atoms use their address */
+
+/* 	MAPPING		*/
+static obj_t* __mapping_destructor(obj_t *_self){
+	mapping_obj *self = (mapping_obj*)_self;
+	if(self->data){
+		munmap(self->data,self->size);
+	}
+	return _self;
+}
+static obj_t* __mapping_clone(obj_t *_self){
+	fprintf(stderr,"ERROR: obj_clone() : %s, a Mapping cannot be cloned\n",obj_name(_self));
+	return NULL;
+}
+static klass_info_t mapping_info;
+const klass_t mapping_klass = {
+	&object_klass,
+	sizeof(mapping_obj),
+	"Mapping",
+	NULL,	//constructor
+	__mapping_destructor,
+	__mapping_clone,
+	NULL,	//equals
+	NULL,	//print
+	NULL,	//hash
+	NULL,	//to
+	NULL,	//get
+	NULL,	//get_index
+	NULL,	//set
+	NULL,	//set_index
+	NULL,	//append
+	NULL,	//rem
+	NULL,	//rem_index
+	NULL,	//len
+	NULL,	//iterator
+	NULL,	//traverse
+	&mapping_info	//info
+};
+const klass_t * Mapping = &mapping_klass;
+
+static int serial_klass(const obj_t *o){
+	obj_t *x = (obj_t*)o;
+	if(obj_instance_of(x,String)){
+		return SERIAL_STRING;
+	}else if(obj_instance_of(x,List)){
+		return SERIAL_LIST;
+	}else if(obj_instance_of(x,Array)){
+		return SERIAL_ARRAY;
+	}else if(obj_instance_of(x,FloatArray)){
+		return SERIAL_FLOATARRAY;
+	}else if(obj_instance_of(x,IntArray)){
+		return SERIAL_INTARRAY;
+	}else if(obj_instance_of(x,Vec3Array)){
+		return SERIAL_VEC3ARRAY;
+	}else if(obj_instance_of(x,Vec4Array)){
+		return SERIAL_VEC4ARRAY;
+	}else if(obj_instance_of(x,Vec)){
+		return SERIAL_VEC;
+	}else if(obj_instance_of(x,Mat)){
+		return SERIAL_MAT;
+	}else if(obj_instance_of(x,HashTable)){
+		return SERIAL_HASHTABLE;
+	}else if(obj_klass(x) == Object){
+		return SERIAL_OBJECT;
+	}
+	return 0;
+}
+
+/*	WRITER		*/
+/* The first pass gives every reachable object and field key a record
+ * and an offset, the second writes the records in the same order. */
+typedef struct entry_s{
+	const void	*ptr;		/* object, or atom when atom is set */
+	int		atom;
+	uint64_t	offset;
+}entry_t;
+
+typedef struct serializer_s{
+	entry_t		*entry;
+	int		length;
+	int		capacity;
+	uint64_t	*key;		/* open addressing, key to entry index + 1 */
+	int		*slot;
+	int		map_capacity;
+	uint64_t	size;
+	FILE		*f;
+	int		error;
+}serializer_t;
+
+static uint64_t map_hash(uint64_t k){
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	return k;
+}
+static int map_find(const serializer_t *w, uint64_t key){
+	uint64_t i;
+	if(!w->map_capacity){
+		return -1;
+	}
+	i = map_hash(key) & (w->map_capacity - 1);
+	while(w->slot[i]){
+		if(w->key[i] == key){
+			return w->slot[i] - 1;
+		}
+		i = (i + 1) & (w->map_capacity - 1);
+	}
+	return -1;
+}
+static int map_put(serializer_t *w, uint64_t key, int index){
+	uint64_t i;
+	if((w->length + 1)*2 > w->map_capacity){
+		int old = w->map_capacity;
+		uint64_t *okey = w->key;
+		int *oslot = w->slot;
+		int j;
+		w->map_capacity = old ? old*2 : 64;
+		w->key  = (uint64_t*)calloc(w->map_capacity,sizeof(uint64_t));
+		w->slot = (int*)calloc(w->map_capacity,sizeof(int));
+		if(!w->key || !w->slot){
+			fprintf(stderr,"ERROR: serial_write() out of memory\n");
+			free(w->key);
+			free(w->slot);
+			w->key = okey;
+			w->slot = oslot;
+			w->map_capacity = old;
+			return 0;
+		}
+		for(j = 0; j < old; j++){
+			if(oslot[j]){
+				i = map_hash(okey[j]) & (w->map_capacity - 1);
+				while(w->slot[i]){
+					i = (i + 1) & (w->map_capacity - 1);
+				}
+				w->key[i] = okey[j];
+				w->slot[i] = oslot[j];
+			}
+		}
+		free(okey);
+		free(oslot);
+	}
+	i = map_hash(key) & (w->map_capacity - 1);
+	while(w->slot[i]){
+		i = (i + 1) & (w->map_capacity - 1);
+	}
+	w->key[i] = key;
+	w->slot[i] = index + 1;
+	return 1;
+}
+static uint64_t payload_size(const obj_t *o, int k){
+	switch(k){
+	case SERIAL_STRING:
+		return PAD8((uint64_t)((const string_obj*)o)->text_length + 1);
+	case SERIAL_LIST:
+	case SERIAL_ARRAY:
+		return (uint64_t)obj_len(o)*8;
+	case SERIAL_FLOATARRAY:
+	case SERIAL_INTARRAY:
+		return PAD8((uint64_t)obj_len(o)*4);
+	case SERIAL_VEC3ARRAY:
+	case SERIAL_VEC4ARRAY:
+		return PAD8((uint64_t)obj_len(o)*((const vecarray_obj*)o)->width*4);
+	case SERIAL_VEC:
+		return 16;
+	case SERIAL_MAT:
+		return 64;
+	}
+	return 0;
+}
+static int field_count(const obj_t *o){
+	return obj(o)->field ? obj(o)->field->field_count : 0;
+}
+static void add_entry(serializer_t *w, const void *ptr, int atom){
+	uint64_t key;
+	entry_t *e;
+	if(!ptr || (!atom && obj_is_immediate(ptr))){
+		return;
+	}
+	if(!atom && (obj_instance_of((obj_t*)ptr,Int) || obj_instance_of((obj_t*)ptr,Float))){
+		return;
+	}
+	key = atom ? (uint64_t)(uintptr_t)ptr : REF_OBJECT | obj(ptr)->handle;
+	if(map_find(w,key) >= 0){
+		return;
+	}
+	if(!atom && !serial_klass(ptr)){
+		fprintf(stderr,"ERROR: serial_write() : cannot write %s, klass %s is not supported\n",obj_name(ptr),obj_klass(ptr)->name);
+		return;
+	}
+	if(w->length == w->capacity){
+		int capacity = w->capacity ? w->capacity*2 : 64;
+		entry_t *a = (entry_t*)realloc(w->entry,capacity*sizeof(entry_t));
+		if(!a){
+			fprintf(stderr,"ERROR: serial_write() out of memory\n");
+			w->error = 1;
+			return;
+		}
+		w->entry = a;
+		w->capacity = capacity;
+	}
+	if(!map_put(w,key,w->length)){
+		w->error = 1;
+		return;
+	}
+	e = &w->entry[w->length++];
+	e->ptr = ptr;
+	e->atom = atom;
+	e->offset = w->size;
+	if(atom){
+		w->size += sizeof(serial_record_t) + PAD8((uint64_t)((const atom_t*)ptr)->length + 1);
+	}else{
+		w->size += sizeof(serial_record_t) + payload_size(ptr,serial_klass(ptr)) + (uint64_t)field_count(ptr)*16;
+	}
+}
+/* entries are appended while the list is walked, it is its own queue */
+static void add_children(serializer_t *w, const obj_t *o){
+	const fieldtable_t *ft = obj(o)->field;
+	int i, k = serial_klass(o);
+	if(k == SERIAL_LIST || k == SERIAL_ARRAY){
+		obj_iter_t it;
+		obj_t *v;
+		obj_for_each(it,v,o){
+			add_entry(w,v,0);
+		}
+	}
+	for(i = 0; ft && i < ft->table_length; i++){
+		if(ft->table[i].key){
+			add_entry(w,ft->table[i].key,1);
+			add_entry(w,ft->table[i].data,0);
+		}
+	}
+}
+static uint64_t ref_of(const serializer_t *w, const obj_t *o){
+	int i;
+	if(!o){
+		return 0;
+	}else if(obj_instance_of((obj_t*)o,Int)){
+		return ((uint64_t)(uint32_t)obj_int(o) << 32) | OBJ_TAG_INT;
+	}else if(obj_instance_of((obj_t*)o,Float)){
+		float f = obj_float(o);
+		uint32_t bits;
+		memcpy(&bits,&f,sizeof(float));
+		return ((uint64_t)bits << 32) | OBJ_TAG_FLOAT;
+	}
+	i = map_find(w,REF_OBJECT | obj(o)->handle);
+	return i >= 0 ? w->entry[i].offset : 0;
+}
+static void put(serializer_t *w, const void *data, size_t size){
+	if(size && fwrite(data,1,size,w->f) != size){
+		w->error = 1;
+	}
+}
+static void put_ref(serializer_t *w, uint64_t ref){
+	put(w,&ref,sizeof(uint64_t));
+}
+static void put_pad(serializer_t *w, uint64_t size){
+	static const char zero[8] = {0};
+	put(w,zero,PAD8(size) - size);
+}
+static void put_record(serializer_t *w, int klass, int flags, int fields, int count, uint64_t size){
+	serial_record_t r;
+	r.klass = klass;
+	r.flags = flags;
+	r.fields = fields;
+	r.count = count;
+	r.size = (uint32_t)size;
+	put(w,&r,sizeof(serial_record_t));
+}
+static void write_entry(serializer_t *w, const entry_t *e){
+	const obj_t *o = e->ptr;
+	const fieldtable_t *ft;
+	int i, k, count;
+	if(e->atom){
+		const atom_t *a = e->ptr;
+		put_record(w,SERIAL_STRING,0,0,a->length,PAD8((uint64_t)a->length + 1));
+		put(w,a->text,a->length + 1);
+		put_pad(w,a->length + 1);
+		return;
+	}
+	k = serial_klass(o);
+	count = obj_len(o) > 0 ? obj_len(o) : 0;
+	switch(k){
+	case SERIAL_STRING:{
+		const string_obj *s = (const string_obj*)o;
+		count = s->text_length;
+		put_record(w,k,0,field_count(o),count,payload_size(o,k));
+		put(w,s->text,count);
+		put(w,"",1);
+		put_pad(w,count + 1);
+		break;
+	}
+	case SERIAL_LIST:
+	case SERIAL_ARRAY:{
+		obj_iter_t it;
+		obj_t *v;
+		put_record(w,k,0,field_count(o),count,payload_size(o,k));
+		obj_for_each(it,v,o){
+			put_ref(w,ref_of(w,v));
+		}
+		break;
+	}
+	case SERIAL_FLOATARRAY:
+	case SERIAL_INTARRAY:
+		put_record(w,k,0,field_count(o),count,payload_size(o,k));
+		put(w,((const typedarray_obj*)o)->data,count*4);
+		put_pad(w,count*4);
+		break;
+	case SERIAL_VEC3ARRAY:
+	case SERIAL_VEC4ARRAY:{
+		const vecarray_obj *a = (const vecarray_obj*)o;
+		put_record(w,k,a->layout,field_count(o),count,payload_size(o,k));
+		if(a->layout == VEC_SOA){
+			for(i = 0; i < a->width; i++){
+				put(w,a->data + i*a->capacity,count*4);
+			}
+		}else{
+			put(w,a->data,count*a->width*4);
+		}
+		put_pad(w,(uint64_t)count*a->width*4);
+		break;
+	}
+	case SERIAL_VEC:
+		put_record(w,k,0,field_count(o),0,16);
+		put(w,&((const vec_obj*)o)->vec,16);
+		break;
+	case SERIAL_MAT:
+		put_record(w,k,0,field_count(o),0,64);
+		put(w,&((const mat_obj*)o)->mat,64);
+		break;
+	default:
+		put_record(w,k,0,field_count(o),0,0);
+	}
+	ft = obj(o)->field;
+	for(i = 0; ft && i < ft->table_length; i++){
+		if(ft->table[i].key){
+			int key = map_find(w,(uint64_t)(uintptr_t)ft->table[i].key);
+			put_ref(w,w->entry[key].offset);
+			put_ref(w,ref_of(w,ft->table[i].data));
+		}
+	}
+}
+size_t	serial_write(FILE *f, const obj_t *root){
+	serializer_t w;
+	serial_header_t h;
+	int i;
+	memset(&w,0,sizeof(serializer_t));
+	w.f = f;
+	w.size = sizeof(serial_header_t);
+	add_entry(&w,root,0);
+	for(i = 0; i < w.length && !w.error; i++){
+		if(!w.entry[i].atom){
+			add_children(&w,w.entry[i].ptr);
+		}
+	}
+	if(!w.error){
+		h.magic = SERIAL_MAGIC;
+		h.version = SERIAL_VERSION;
+		h.records = w.length;
+		h.reserved = 0;
+		h.size = w.size;
+		h.root = ref_of(&w,root);
+		put(&w,&h,sizeof(serial_header_t));
+		for(i = 0; i < w.length && !w.error; i++){
+			write_entry(&w,&w.entry[i]);
+		}
+		if(w.error){
+			fprintf(stderr,"ERROR: serial_write() : write failed\n");
+		}
+	}
+	free(w.entry);
+	free(w.key);
+	free(w.slot);
+	return w.error ? 0 : (size_t)w.size;
+}
+
+/*	READER		*/
+typedef struct reader_s{
+	const char	*data;
+	uint64_t	size;
+	uint32_t	count;
+	uint64_t	*offset;
+	obj_t		**object;
+	obj_t		*mapping;	/* NULL when copying */
+}reader_t;
+
+#define record_at(r,off) ((const serial_record_t*)((r)->data + (off)))
+#define payload_of(rec) ((const char*)(rec) + sizeof(serial_record_t))
+
+static int find_record(const reader_t *r, uint64_t offset){
+	int lo = 0, hi = (int)r->count - 1;
+	while(lo <= hi){
+		int mid = (lo + hi)/2;
+		if(r->offset[mid] == offset){
+			return mid;
+		}else if(r->offset[mid] < offset){
+			lo = mid + 1;
+		}else{
+			hi = mid - 1;
+		}
+	}
+	return -1;
+}
+/* Numbers are returned as new references, records as borrowed ones.
+ * Returns 0 on an invalid reference. */
+static int resolve(const reader_t *r, uint64_t ref, obj_t **value){
+	int i;
+	if(!ref){
+		*value = NULL;
+		return 1;
+	}else if((ref & 7) == OBJ_TAG_INT){
+		*value = obj_new(Int,(int)(uint32_t)(ref >> 32));
+		return 1;
+	}else if((ref & 7) == OBJ_TAG_FLOAT){
+		uint32_t bits = (uint32_t)(ref >> 32);
+		float f;
+		memcpy(&f,&bits,sizeof(float));
+		*value = obj_new(Float,(double)f);
+		return 1;
+	}else if((i = find_record(r,ref)) >= 0){
+		*value = r->object[i];
+		return 1;
+	}
+	fprintf(stderr,"ERROR: serial_read() : invalid reference %llx\n",(unsigned long long)ref);
+	return 0;
+}
+static int is_number(uint64_t ref){
+	return (ref & 7) == OBJ_TAG_INT || (ref & 7) == OBJ_TAG_FLOAT;
+}
+static obj_t *new_borrowed_array(const reader_t *r, const klass_t *klass, const void *data, int count, int layout){
+	obj_t *o = (klass == Vec3Array || klass == Vec4Array) ? obj_new(klass,r->mapping ? 0 : count,layout) : obj_new(klass,r->mapping ? 0 : count);
+	int width = klass == Vec3Array ? 3 : klass == Vec4Array ? 4 : 1;
+	if(!o){
+		return NULL;
+	}
+	if(klass == Vec3Array || klass == Vec4Array){
+		vecarray_obj *a = (vecarray_obj*)o;
+		if(r->mapping){
+			a->data = (float*)data;
+			a->storage = obj_ref(r->mapping);
+		}else{
+			memcpy(a->data,data,(size_t)count*width*4);
+		}
+		a->length = a->capacity = count;
+	}else{
+		typedarray_obj *a = (typedarray_obj*)o;
+		if(r->mapping){
+			a->data = (void*)data;
+			a->storage = obj_ref(r->mapping);
+		}else{
+			memcpy(a->data,data,(size_t)count*4);
+		}
+		a->length = a->capacity = count;
+	}
+	return o;
+}
+/* checks a record and creates its object, without its references */
+static obj_t *new_object(const reader_t *r, const serial_record_t *rec){
+	const char *p = payload_of(rec);
+	uint64_t need = 0;
+	int width = 0;
+	switch(rec->klass){
+	case SERIAL_STRING:	need = (uint64_t)rec->count + 1;	break;
+	case SERIAL_LIST:
+	case SERIAL_ARRAY:	need = (uint64_t)rec->count*8;	break;
+	case SERIAL_FLOATARRAY:
+	case SERIAL_INTARRAY:	need = (uint64_t)rec->count*4;	break;
+	case SERIAL_VEC3ARRAY:	width = 3;	need = (uint64_t)rec->count*12;	break;
+	case SERIAL_VEC4ARRAY:	width = 4;	need = (uint64_t)rec->count*16;	break;
+	case SERIAL_VEC:	need = 16;	break;
+	case SERIAL_MAT:	need = 64;	break;
+	case SERIAL_OBJECT:
+	case SERIAL_HASHTABLE:	break;
+	default:
+		fprintf(stderr,"ERROR: serial_read() : unknown record klass %d\n",rec->klass);
+		return NULL;
+	}
+	if(need > rec->size || (rec->klass == SERIAL_STRING && p[rec->count])){
+		fprintf(stderr,"ERROR: serial_read() : truncated record of klass %d\n",rec->klass);
+		return NULL;
+	}
+	switch(rec->klass){
+	case SERIAL_OBJECT:
+		return obj_new(Object);
+	case SERIAL_HASHTABLE:
+		return obj_new(HashTable);
+	case SERIAL_STRING:
+		if(r->mapping){
+			string_obj *s = (string_obj*)obj_new(String,NULL);
+			if(s){
+				s->text = (char*)p;
+				s->text_length = rec->count;
+				s->storage = obj_ref(r->mapping);
+			}
+			return s;
+		}
+		return string_from_text(p,rec->count);
+	case SERIAL_LIST:
+		return obj_new(List);
+	case SERIAL_ARRAY:
+		return obj_new(Array,(int)rec->count);
+	case SERIAL_FLOATARRAY:
+		return new_borrowed_array(r,FloatArray,p,rec->count,0);
+	case SERIAL_INTARRAY:
+		return new_borrowed_array(r,IntArray,p,rec->count,0);
+	case SERIAL_VEC3ARRAY:
+	case SERIAL_VEC4ARRAY:
+		return new_borrowed_array(r,width == 3 ? Vec3Array : Vec4Array,p,rec->count,rec->flags);
+	case SERIAL_VEC:{
+		vec4_t v;
+		memcpy(&v,p,16);
+		return obj_new(Vec,(double)v.x,(double)v.y,(double)v.z,(double)v.w);
+	}
+	case SERIAL_MAT:{
+		mat4_t m;
+		memcpy(&m,p,64);
+		return obj_new(Mat,&m);
+	}
+	}
+	return NULL;
+}
+/* fills the references of the object of record i */
+static int link_object(const reader_t *r, int i){
+	const serial_record_t *rec = record_at(r,r->offset[i]);
+	const char *refs = payload_of(rec);
+	obj_t *self = r->object[i];
+	uint32_t j;
+	if(rec->klass == SERIAL_LIST || rec->klass == SERIAL_ARRAY){
+		for(j = 0; j < rec->count; j++){
+			uint64_t ref;
+			obj_t *v;
+			memcpy(&ref,refs + j*8,8);
+			if(!resolve(r,ref,&v)){
+				return 0;
+			}
+			if(rec->klass == SERIAL_LIST){
+				list_append(self,v);
+			}else{
+				array_set(self,j,v);
+			}
+			if(is_number(ref)){
+				obj_unref(v);
+			}
+		}
+	}
+	refs += rec->size;
+	for(j = 0; j < rec->fields; j++){
+		uint64_t key, ref;
+		const serial_record_t *krec;
+		const atom_t *a;
+		obj_t *v;
+		int k;
+		memcpy(&key,refs + j*16,8);
+		memcpy(&ref,refs + j*16 + 8,8);
+		k = find_record(r,key);
+		if(k < 0 || (krec = record_at(r,key))->klass != SERIAL_STRING){
+			fprintf(stderr,"ERROR: serial_read() : field key %llx is not a String\n",(unsigned long long)key);
+			return 0;
+		}
+		if(!resolve(r,ref,&v)){
+			return 0;
+		}
+		a = atom_len(payload_of(krec),krec->count);
+		obj_set_field_atom(self,a,v);
+		if(is_number(ref)){
+			obj_unref(v);
+		}
+	}
+	return 1;
+}
+static obj_t *read_graph(reader_t *r){
+	const serial_header_t *h = (const serial_header_t*)r->data;
+	uint64_t off = sizeof(serial_header_t);
+	obj_t *root = NULL;
+	uint32_t i, n = 0;
+	int ok = 1;
+	if(r->size < sizeof(serial_header_t) || h->magic != SERIAL_MAGIC){
+		fprintf(stderr,"ERROR: serial_read() : not an object graph\n");
+		return NULL;
+	}else if(h->version != SERIAL_VERSION){
+		fprintf(stderr,"ERROR: serial_read() : unsupported version %u\n",h->version);
+		return NULL;
+	}else if(h->size > r->size || h->records > h->size/sizeof(serial_record_t)){
+		fprintf(stderr,"ERROR: serial_read() : truncated data\n");
+		return NULL;
+	}
+	r->count = h->records;
+	r->offset = (uint64_t*)malloc((r->count + 1)*sizeof(uint64_t));
+	r->object = (obj_t**)calloc(r->count + 1,sizeof(obj_t*));
+	if(!r->offset || !r->object){
+		fprintf(stderr,"ERROR: serial_read() out of memory\n");
+		ok = 0;
+	}
+	for(n = 0; ok && n < r->count; n++){
+		const serial_record_t *rec = record_at(r,off);
+		if(off + sizeof(serial_record_t) > h->size || rec->size & 7
+			|| off + sizeof(serial_record_t) + rec->size + (uint64_t)rec->fields*16 > h->size){
+			fprintf(stderr,"ERROR: serial_read() : truncated data\n");
+			ok = 0;
+			break;
+		}
+		r->offset[n] = off;
+		r->object[n] = new_object(r,rec);
+		if(!r->object[n]){
+			ok = 0;
+			break;
+		}
+		off += sizeof(serial_record_t) + rec->size + (uint64_t)rec->fields*16;
+	}
+	for(i = 0; ok && i < r->count; i++){
+		ok = link_object(r,i);
+	}
+	if(ok && resolve(r,h->root,&root) && root && !is_number(h->root)){
+		obj_ref(root);
+	}
+	for(i = 0; i < n; i++){
+		obj_unref(r->object[i]);
+	}
+	free(r->offset);
+	free(r->object);
+	return ok ? root : NULL;
+}
+obj_t*	serial_read(const void *data, size_t size){
+	reader_t r;
+	memset(&r,0,sizeof(reader_t));
+	r.data = (const char*)data;
+	r.size = size;
+	return read_graph(&r);
+}
+obj_t*	serial_map(const char *path){
+	reader_t r;
+	mapping_obj *m;
+	struct stat st;
+	obj_t *root;
+	void *data;
+	int fd = open(path,O_RDONLY);
+	if(fd < 0 || fstat(fd,&st) || !st.st_size){
+		fprintf(stderr,"ERROR: serial_map() : cannot open %s\n",path);
+		if(fd >= 0){
+			close(fd);
+		}
+		return NULL;
+	}
+	data = mmap(NULL,st.st_size,PROT_READ | PROT_WRITE,MAP_PRIVATE,fd,0);
+	close(fd);
+	if(data == MAP_FAILED){
+		fprintf(stderr,"ERROR: serial_map() : cannot map %s\n",path);
+		return NULL;
+	}
+	m = (mapping_obj*)obj_new(Mapping);
+	if(!m){
+		munmap(data,st.st_size);
+		return NULL;
+	}
+	m->data = data;
+	m->size = st.st_size;
+	memset(&r,0,sizeof(reader_t));
+	r.data = (const char*)data;
+	r.size = st.st_size;
+	r.mapping = m;
+	root = read_graph(&r);
+	obj_unref(m);
+	return root;
+}
@@ -0,0 +1,75 @@
+#ifndef __3DE_SERIAL_H__
+#define __3DE_SERIAL_H__
+#include <stdio.h>
+#include <stdint.h>
+#include "object.h"
+
+/* Binary format for object graphs.
+ * A file is a serial_header_t followed by records. A record is a
+ * serial_record_t, its payload padded to 8 bytes, then one (key, value)
+ * pair of references per field. References are 64 bit: 0 is NULL, Int
+ * and Float values are tagged in place like immediates (OBJ_TAG_INT and
+ * OBJ_TAG_FLOAT, the value in the upper half), anything else is the
+ * offset of a record from the start of the file. Each object is written
+ * once, so shared objects and cycles come back as they were. Field keys
+ * are references to String records. Everything is in native byte order,
+ * a file written on another order fails the magic check. */
+
+#define SERIAL_MAGIC	0x5245534e	/* "NSER" */
+#define SERIAL_VERSION	1
+
+enum serial_klass{
+	SERIAL_OBJECT = 1,	/* fields only */
+	SERIAL_HASHTABLE,	/* fields only */
+	SERIAL_STRING,		/* count bytes of text and a NUL */
+	SERIAL_LIST,		/* count references */
+	SERIAL_ARRAY,		/* count references */
+	SERIAL_FLOATARRAY,	/* count floats */
+	SERIAL_INTARRAY,	/* count int32 */
+	SERIAL_VEC3ARRAY,	/* count vectors, flags is the layout, SoA planes are count floats long */
+	SERIAL_VEC4ARRAY,
+	SERIAL_VEC,		/* 4 floats */
+	SERIAL_MAT		/* 16 floats */
+};
+
+typedef struct serial_header_s{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	records;
+	uint32_t	reserved;
+	uint64_t	size;		/* of the whole file */
+	uint64_t	root;		/* reference */
+}serial_header_t;
+
+typedef struct serial_record_s{
+	uint16_t	klass;		/* SERIAL_* */
+	uint16_t	flags;
+	uint32_t	fields;
+	uint32_t	count;
+	uint32_t	size;		/* of the padded payload */
+}serial_record_t;
+
+/* Writes the graph reachable from root, returns the number of bytes
+ * written or 0 on error. Objects of other klasses are written as NULL. */
+size_t	serial_write(FILE *f, const obj_t *root);
+
+/* Rebuilds the graph from a buffer holding a file, copying everything. */
+obj_t*	serial_read(const void *data, size_t size);
+
+/* Maps a file and rebuilds its graph without copying: Strings and typed
+ * arrays point into the mapping, which is a Mapping object they hold a
+ * reference to, it is unmapped with its last borrower. The mapping is
+ * private, writing to borrowed data never changes the file, and a typed
+ * array copies its data out of it when it grows. */
+obj_t*	serial_map(const char *path);
+
+extern const klass_t mapping_klass;
+extern const klass_t *Mapping;
+
+typedef struct mapping_s{
+	object_t ___;
+	void	*data;
+	size_t	size;
+}mapping_obj;
+
+#endif
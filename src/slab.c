@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "slab.h"
+
+#define slab_of(ptr) ((slab_t*)((uintptr_t)(ptr) & ~(uintptr_t)(SLAB_SIZE-1)))
+#define slab_slots(s) ((char*)(s) + SLAB_LINE)
+#define SLAB_ROOM (SLAB_SIZE - SLAB_LINE)
+
+static slab_pool_t  *pools = NULL;
+static sync_lock_t  pools_lock = 0;
+static THREAD_LOCAL slab_arena_t *arena = NULL;
+static slab_arena_t *arenas = NULL;
+static sync_lock_t  arenas_lock = 0;
+
+static slab_t *new_slab(size_t size){
+	void *mem = NULL;
+	slab_t *s;
+	if(posix_memalign(&mem,SLAB_SIZE,size)){
+		fprintf(stderr,"ERROR: new_slab() out of memory\n");
+		return NULL;
+	}
+	s = (slab_t*)mem;
+	memset(s,0,sizeof(slab_t));
+	return s;
+}
+void	slab_pool_init(slab_pool_t *pool, const char *name, int size, int arena){
+	memset(pool,0,sizeof(slab_pool_t));
+	pool->name = name;
+	pool->slot_size = (size + SLAB_GRAIN - 1) & ~(SLAB_GRAIN - 1);
+	pool->arena = arena;
+	sync_lock(&pools_lock);
+	pool->next = pools;
+	pools = pool;
+	sync_unlock(&pools_lock);
+}
+static void *arena_alloc(slab_pool_t *pool){
+	slab_t *s = arena->slabs;
+	void *ptr;
+	if(pool->slot_size > SLAB_ROOM){
+		s = new_slab(SLAB_LINE + pool->slot_size);
+		if(!s){
+			return NULL;
+		}
+		s->large = 1;
+	}else if(!s || s->large || s->used + pool->slot_size > SLAB_ROOM){
+		s = new_slab(SLAB_SIZE);
+		if(!s){
+			return NULL;
+		}
+	}
+	if(s != arena->slabs){
+		s->arena = arena;
+		s->next  = arena->slabs;
+		arena->slabs = s;
+	}
+	ptr = slab_slots(s) + s->used;
+	s->used += pool->slot_size;
+	SYNC_INC(arena->live);
+	return ptr;
+}
+static void *pool_alloc(slab_pool_t *pool){
+	slab_t *s = pool->slabs;
+	void *ptr;
+	if(pool->free){
+		ptr = pool->free;
+		pool->free = *(void**)ptr;
+		pool->recycled++;
+		return ptr;
+	}
+	if(pool->slot_size > SLAB_ROOM){
+		s = new_slab(SLAB_LINE + pool->slot_size);
+		if(!s){
+			return NULL;
+		}
+		s->large = 1;
+	}else if(!s || s->used + pool->slot_size > SLAB_ROOM){
+		s = new_slab(SLAB_SIZE);
+		if(!s){
+			return NULL;
+		}
+	}
+	if(s != pool->slabs){
+		s->pool = pool;
+		s->slot_size = pool->slot_size;
+		if(s->large){
+			s->next = pool->large;
+			pool->large = s;
+		}else{
+			s->next = pool->slabs;
+			pool->slabs = s;
+		}
+	}
+	ptr = slab_slots(s) + s->used;
+	s->used += pool->slot_size;
+	return ptr;
+}
+void*	slab_alloc(slab_pool_t *pool){
+	void *ptr;
+	sync_lock(&pool->lock);
+	ptr = arena && pool->arena ? arena_alloc(pool) : pool_alloc(pool);
+	if(ptr){
+		pool->live++;
+		if(pool->live > pool->peak){
+			pool->peak = pool->live;
+		}
+	}
+	sync_unlock(&pool->lock);
+	return ptr;
+}
+/* the last reference on the arena is gone, either its end or its last
+ * live slot */
+static void arena_release(slab_arena_t *a){
+	slab_arena_t **link;
+	slab_t *s = a->slabs;
+	sync_lock(&arenas_lock);
+	for(link = &arenas; *link != a; link = &(*link)->next);
+	*link = a->next;
+	sync_unlock(&arenas_lock);
+	while(s){
+		slab_t *next = s->next;
+		free(s);
+		s = next;
+	}
+	free(a);
+}
+void	slab_free(slab_pool_t *pool, void *ptr){
+	slab_t *s = slab_of(ptr);
+	sync_lock(&pool->lock);
+	pool->live--;
+	if(s->large && !s->arena){
+		slab_t **link;
+		for(link = &pool->large; *link != s; link = &(*link)->next);
+		*link = s->next;
+		free(s);
+	}else if(!s->arena){
+		*(void**)ptr = pool->free;
+		pool->free = ptr;
+	}
+	sync_unlock(&pool->lock);
+	if(s->arena && !SYNC_DEC(s->arena->live)){
+		arena_release(s->arena);
+	}
+}
+void	slab_arena_begin(void){
+	slab_arena_t *a = malloc(sizeof(slab_arena_t));
+	if(!a){
+		fprintf(stderr,"ERROR: slab_arena_begin() out of memory\n");
+		return;
+	}
+	a->slabs = NULL;
+	a->live  = 1;	/* held until slab_arena_end() */
+	a->prev  = arena;
+	arena = a;
+	sync_lock(&arenas_lock);
+	a->next = arenas;
+	arenas = a;
+	sync_unlock(&arenas_lock);
+}
+void	slab_arena_end(void){
+	slab_arena_t *a = arena;
+	if(!a){
+		fprintf(stderr,"ERROR: slab_arena_end() : no arena is open\n");
+		return;
+	}
+	arena = a->prev;
+	if(!SYNC_DEC(a->live)){
+		arena_release(a);
+	}
+}
+int	slab_in_arena(const void *ptr){
+	return slab_of(ptr)->arena != NULL;
+}
+typedef struct slab_span_s{
+	slab_t	*slab;
+	int	used;
+}slab_span_t;
+
+static int span_compare(const void *a, const void *b){
+	uintptr_t x = (uintptr_t)((const slab_span_t*)a)->slab;
+	uintptr_t y = (uintptr_t)((const slab_span_t*)b)->slab;
+	return x < y ? -1 : x > y;
+}
+/* appends the slabs of list to spans, or only counts them when spans is
+ * NULL */
+static int list_spans(slab_t *s, slab_span_t *spans, int count){
+	for(; s; s = s->next, count++){
+		if(spans){
+			spans[count].slab = s;
+			spans[count].used = s->used;
+		}
+	}
+	return count;
+}
+static int collect_spans(slab_pool_t *pool, slab_span_t *spans){
+	slab_arena_t *a;
+	int count = 0;
+	if(pool){
+		count = list_spans(pool->slabs,spans,count);
+		return list_spans(pool->large,spans,count);
+	}
+	for(a = arenas; a; a = a->next){
+		count = list_spans(a->slabs,spans,count);
+	}
+	return count;
+}
+int	slab_walk(slab_pool_t *pool, slab_visit_t visit, void *ctx){
+	sync_lock_t *lock = pool ? &pool->lock : &arenas_lock;
+	slab_span_t *spans;
+	int count, i;
+	sync_lock(lock);
+	count = collect_spans(pool,NULL);
+	spans = (slab_span_t*)malloc((count + 1)*sizeof(slab_span_t));
+	if(!spans){
+		sync_unlock(lock);
+		fprintf(stderr,"ERROR: slab_walk(%s) out of memory\n",pool ? pool->name : "arenas");
+		return -1;
+	}
+	collect_spans(pool,spans);
+	sync_unlock(lock);
+	qsort(spans,count,sizeof(slab_span_t),span_compare);
+	for(i = 0; i < count; i++){
+		visit(slab_slots(spans[i].slab),spans[i].used,spans[i].slab->slot_size,ctx);
+	}
+	free(spans);
+	return count;
+}
+const slab_pool_t *slab_pools(void){
+	return pools;
+}
+void	slab_report(FILE *f){
+	const slab_pool_t *p = pools;
+	fprintf(f,"%-16s %6s %10s %10s %10s\n","pool","slot","live","peak","recycled");
+	while(p){
+		fprintf(f,"%-16s %6d %10u %10u %10u\n",p->name,p->slot_size,p->live,p->peak,p->recycled);
+		p = p->next;
+	}
+}
@@ -0,0 +1,79 @@
+#ifndef __3DE_SLAB_H__
+#define __3DE_SLAB_H__
+#include <stdio.h>
+#include "sync.h"
+
+/* Fixed size slot allocator used for objects.
+ * Memory is carved out of SLAB_SIZE blocks aligned on SLAB_SIZE, so the
+ * block header of any slot is found by masking its address. The header
+ * takes the first cache line and the slots follow it. */
+
+#define SLAB_SIZE	65536
+#define SLAB_LINE	64
+#define SLAB_GRAIN	16
+
+struct slab_pool_s;
+struct slab_arena_s;
+
+typedef struct slab_s{
+	struct slab_pool_s  *pool;	/* owner pool, NULL for arena slabs */
+	struct slab_arena_s *arena;	/* owner arena, NULL for pool slabs */
+	struct slab_s	*next;
+	int		slot_size;	/* 0 for mixed size arena slabs */
+	int		used;		/* bytes handed out after the header */
+	int		large;		/* single oversized slot, freed on release */
+}slab_t;
+
+typedef struct slab_pool_s{
+	const char	*name;
+	int		slot_size;
+	void		*free;		/* free list of recycled slots */
+	slab_t		*slabs;
+	unsigned int	live;		/* slots currently handed out */
+	unsigned int	peak;		/* highest value of live */
+	unsigned int	recycled;	/* allocations served from the free list */
+	int		arena;		/* served from the open arena, if any */
+	slab_t		*large;		/* oversized slots, one slab each */
+	struct slab_pool_s *next;	/* list of every initialized pool */
+	sync_lock_t	lock;
+}slab_pool_t;
+
+typedef struct slab_arena_s{
+	slab_t		*slabs;
+	unsigned int	live;		/* slots handed out, + 1 while open */
+	struct slab_arena_s *prev;	/* enclosing arena of the thread */
+	struct slab_arena_s *next;	/* list of every arena not released */
+}slab_arena_t;
+
+/* arena tells whether slab_alloc() serves the pool from the open arena.
+ * Pools of storage owned by objects pass 0: the owner may have been
+ * created before the arena and keep its storage long after it. */
+void	slab_pool_init(slab_pool_t *pool, const char *name, int size, int arena);
+void*	slab_alloc(slab_pool_t *pool);
+void	slab_free(slab_pool_t *pool, void *ptr);
+
+/* While an arena is open every slab_alloc() of an arena pool is served
+ * from it. Freed arena slots are not recycled, the whole arena is given
+ * back to the system at once: by slab_arena_end() when none of its slots
+ * is live anymore, or else by the slab_free() of the last one, so that
+ * slots which outlive their arena stay valid. Arenas nest and belong to
+ * the thread that opened them, their slots may be freed by any thread. */
+void	slab_arena_begin(void);
+void	slab_arena_end(void);
+int	slab_in_arena(const void *ptr);
+
+/* Calls visit on the slabs of pool, or of every arena not released when
+ * pool is NULL, in address order. visit gets the first slot of the slab,
+ * the bytes carved out from there and the slot size, 0 for arena slabs
+ * that mix pools; slots are visited whether handed out or free, telling
+ * them apart is up to the caller. The slabs are listed under the pool
+ * lock and visited once it is released: visit may allocate, but no other
+ * thread may free, nor allocate from an arena, meanwhile. Returns the
+ * number of slabs, or -1 when out of memory. */
+typedef void (*slab_visit_t)(char *slots, int used, int slot_size, void *ctx);
+int	slab_walk(slab_pool_t *pool, slab_visit_t visit, void *ctx);
+
+const slab_pool_t *slab_pools(void);
+void	slab_report(FILE *f);
+
+#endif
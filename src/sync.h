@@ -0,0 +1,58 @@
+#ifndef __3DE_SYNC_H__
+#define __3DE_SYNC_H__
+
+/* Building with OBJ_THREADS makes the object runtime usable from several
+ * threads: refcounts and uids are updated atomically and the global
+ * tables (klasses, slab pools, atoms, names) are guarded by spinlocks.
+ * The flags of an object are set and cleared atomically.
+ * Objects themselves are not locked, mutating one object from two
+ * threads at once still needs external synchronization.
+ * Without OBJ_THREADS all of this compiles to plain operations. */
+
+#ifdef OBJ_THREADS
+#include <sched.h>
+
+typedef int sync_lock_t;
+
+#define THREAD_LOCAL		__thread
+#define SYNC_INC(x)		__atomic_add_fetch(&(x),1,__ATOMIC_RELAXED)
+#define SYNC_DEC(x)		__atomic_sub_fetch(&(x),1,__ATOMIC_ACQ_REL)
+#define SYNC_ADD(x,v)		__atomic_add_fetch(&(x),(v),__ATOMIC_RELAXED)
+#define SYNC_OR(x,v)		__atomic_or_fetch(&(x),(v),__ATOMIC_ACQ_REL)
+#define SYNC_AND(x,v)		__atomic_and_fetch(&(x),(v),__ATOMIC_ACQ_REL)
+#define SYNC_LOAD(x)		__atomic_load_n(&(x),__ATOMIC_ACQUIRE)
+#define SYNC_STORE(x,v)		__atomic_store_n(&(x),(v),__ATOMIC_RELEASE)
+/* stores v if x holds expected, else loads x into expected */
+#define SYNC_CAS(x,expected,v)	__atomic_compare_exchange_n(&(x),&(expected),(v),0,__ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE)
+#define SYNC_FENCE()		__atomic_thread_fence(__ATOMIC_RELEASE)
+
+static inline void sync_lock(sync_lock_t *l){
+	while(__atomic_exchange_n(l,1,__ATOMIC_ACQUIRE)){
+		while(__atomic_load_n(l,__ATOMIC_RELAXED)){
+			sched_yield();
+		}
+	}
+}
+static inline void sync_unlock(sync_lock_t *l){
+	__atomic_store_n(l,0,__ATOMIC_RELEASE);
+}
+#else
+
+typedef int sync_lock_t;
+
+#define THREAD_LOCAL
+#define SYNC_INC(x)		(++(x))
+#define SYNC_DEC(x)		(--(x))
+#define SYNC_ADD(x,v)		((x) += (v))
+#define SYNC_OR(x,v)		((x) |= (v))
+#define SYNC_AND(x,v)		((x) &= (v))
+#define SYNC_LOAD(x)		(x)
+#define SYNC_STORE(x,v)		((x) = (v))
+#define SYNC_CAS(x,expected,v)	((x) == (expected) ? ((x) = (v), 1) : ((expected) = (x), 0))
+#define SYNC_FENCE()
+
+#define sync_lock(l)		((void)(l))
+#define sync_unlock(l)		((void)(l))
+#endif
+
+#endif
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "object.h"
+#include "trace.h"
+
+#ifdef OBJ_TRACE
+
+typedef struct trace_ring_s{
+	unsigned long long	head;	/* events ever written */
+	unsigned long long	snapshot;	/* head seen by the current dump */
+	int			thread;
+	struct trace_ring_s	*next;
+	trace_event_t		event[TRACE_RING_LENGTH];
+}trace_ring_t;
+
+static trace_ring_t *rings = NULL;
+static sync_lock_t rings_lock = 0;
+static int thread_count = 0;
+static THREAD_LOCAL trace_ring_t *ring = NULL;
+
+static trace_ring_t *new_ring(void){
+	trace_ring_t *r = calloc(1,sizeof(trace_ring_t));
+	if(!r){
+		fprintf(stderr,"ERROR: trace_event() out of memory\n");
+		return NULL;
+	}
+	sync_lock(&rings_lock);
+	r->thread = thread_count++;
+	r->next = rings;
+	rings = r;
+	sync_unlock(&rings_lock);
+	return r;
+}
+/* Only the owner thread writes to its ring, it publishes an event by
+ * storing the new head with release semantics. */
+void	trace_event(int kind, int klass_id, unsigned long long uid){
+	struct timespec ts;
+	trace_event_t *e;
+	if(!ring && !(ring = new_ring())){
+		return;
+	}
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	e = &ring->event[ring->head & (TRACE_RING_LENGTH - 1)];
+	e->time   = (unsigned long long)ts.tv_sec*1000000000ull + ts.tv_nsec;
+	e->uid    = uid;
+	e->klass  = klass_id;
+	e->kind   = kind;
+	e->thread = ring->thread;
+	SYNC_STORE(ring->head,ring->head + 1);
+}
+/* Threads keep running during a dump, a busy ring may overwrite some of
+ * its oldest events before they are written out. */
+static int dump(FILE *f, int csv){
+	trace_ring_t *r;
+	int count = 0;
+	sync_lock(&rings_lock);
+	for(r = rings; r; r = r->next){
+		r->snapshot = SYNC_LOAD(r->head);
+		count += r->snapshot < TRACE_RING_LENGTH ? r->snapshot : TRACE_RING_LENGTH;
+	}
+	if(!csv){
+		unsigned int header[3] = {TRACE_MAGIC,TRACE_VERSION,count};
+		fwrite(header,sizeof(header),1,f);
+	}else{
+		fprintf(f,"thread,time,event,klass,uid\n");
+	}
+	for(r = rings; r; r = r->next){
+		unsigned long long head = r->snapshot;
+		unsigned long long i = head < TRACE_RING_LENGTH ? 0 : head - TRACE_RING_LENGTH;
+		for(; i < head; i++){
+			const trace_event_t *e = &r->event[i & (TRACE_RING_LENGTH - 1)];
+			if(csv){
+				const klass_t *k = klass_by_id(e->klass);
+				fprintf(f,"%d,%llu,%s,%s,%llu\n",e->thread,e->time,
+					e->kind == TRACE_EV_ALLOC ? "alloc" : "free",
+					k ? k->name : "?",e->uid);
+			}else{
+				fwrite(e,sizeof(trace_event_t),1,f);
+			}
+		}
+	}
+	sync_unlock(&rings_lock);
+	return count;
+}
+int	trace_dump_csv(FILE *f){
+	return dump(f,1);
+}
+int	trace_dump_binary(FILE *f){
+	return dump(f,0);
+}
+
+#else
+
+void	trace_event(int kind, int klass_id, unsigned long long uid){
+}
+int	trace_dump_csv(FILE *f){
+	return 0;
+}
+int	trace_dump_binary(FILE *f){
+	return 0;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef __3DE_TRACE_H__
+#define __3DE_TRACE_H__
+#include <stdio.h>
+
+/* Object lifecycle tracing. Built with OBJ_TRACE, obj_new() and
+ * obj_free() append an event to a ring buffer owned by the calling
+ * thread; without it the TRACE_ macros expand to nothing.
+ * Each ring holds the last TRACE_RING_LENGTH events of its thread. */
+
+#define TRACE_RING_LENGTH	65536
+#define TRACE_MAGIC		0x4352544e	/* "NTRC" */
+#define TRACE_VERSION		2
+
+enum trace_kind{
+	TRACE_EV_ALLOC,
+	TRACE_EV_FREE
+};
+
+typedef struct trace_event_s{
+	unsigned long long	time;	/* CLOCK_MONOTONIC, nanoseconds */
+	unsigned long long	uid;	/* see obj_uid(), pairs an alloc with its free */
+	unsigned short		klass;	/* klass id, see klass_by_id() */
+	unsigned char		kind;
+	unsigned char		thread;
+}trace_event_t;
+
+#ifdef OBJ_TRACE
+#define TRACE_ALLOC(klass_id,uid)	trace_event(TRACE_EV_ALLOC,(klass_id),(uid))
+#define TRACE_FREE(klass_id,uid)	trace_event(TRACE_EV_FREE,(klass_id),(uid))
+#else
+#define TRACE_ALLOC(klass_id,uid)
+#define TRACE_FREE(klass_id,uid)
+#endif
+
+void	trace_event(int kind, int klass_id, unsigned long long uid);
+
+/* Dumps the events of every thread ring. The CSV form has one
+ * thread,time,event,klass,uid line per event. The binary form is a
+ * header of three unsigned ints (magic, version, event count) followed
+ * by the trace_event_t records. Both return the number of events. */
+int	trace_dump_csv(FILE *f);
+int	trace_dump_binary(FILE *f);
+
+#endif
@@ -1,4 +1,5 @@
 #include "vector.h"
+#include "heap.h"
 #include "assert.h"
 #include <math.h>
 #include <stdio.h>
@@ -122,6 +123,24 @@ vec3_t *vec3_scale2(vec3_t *dst,const vec3_t *a, float factor){
 	dst->z = a->z * factor;
 	return dst;
 }
+/* span versions, over count contiguous vectors */
+vec3_t *vec3_add_n(vec3_t *dst, const vec3_t *src, int count){
+	float *d = tab(dst);
+	const float *a = tab(src);
+	int i = count*3;
+	while(i--){
+		d[i] += a[i];
+	}
+	return dst;
+}
+vec3_t *vec3_scale_n(vec3_t *dst, float factor, int count){
+	float *d = tab(dst);
+	int i = count*3;
+	while(i--){
+		d[i] *= factor;
+	}
+	return dst;
+}
 
 int	vec3_equals(const vec3_t *a, const vec3_t *b){
 	if( fabsf(a->x - b->x) > EPSILON ){
@@ -309,6 +328,29 @@ vec3_t *mat4_mult2_vec3(vec3_t *dst, const mat4_t *mat, const vec3_t *vec){
 	vec3_copy(dst,vec3(&dst4));
 	return dst;
 }
+/* transforms count points, dst and vec may be the same span */
+vec3_t *mat4_mult2_vec3_n(vec3_t *dst, const mat4_t *mat, const vec3_t *vec, int count){
+	int i;
+	for(i = 0; i < count; i++){
+		float x = vec[i].x, y = vec[i].y, z = vec[i].z;
+		float w = 1.0f/(mat->wx*x + mat->wy*y + mat->wz*z + mat->ww);
+		dst[i].x = (mat->xx*x + mat->xy*y + mat->xz*z + mat->xw)*w;
+		dst[i].y = (mat->yx*x + mat->yy*y + mat->yz*z + mat->yw)*w;
+		dst[i].z = (mat->zx*x + mat->zy*y + mat->zz*z + mat->zw)*w;
+	}
+	return dst;
+}
+/* same on separate x,y,z arrays, in place */
+void	mat4_mult_soa(const mat4_t *mat, float *xs, float *ys, float *zs, int count){
+	int i;
+	for(i = 0; i < count; i++){
+		float x = xs[i], y = ys[i], z = zs[i];
+		float w = 1.0f/(mat->wx*x + mat->wy*y + mat->wz*z + mat->ww);
+		xs[i] = (mat->xx*x + mat->xy*y + mat->xz*z + mat->xw)*w;
+		ys[i] = (mat->yx*x + mat->yy*y + mat->yz*z + mat->yw)*w;
+		zs[i] = (mat->zx*x + mat->zy*y + mat->zz*z + mat->zw)*w;
+	}
+}
 
 /* ==== OBJECT WRAPPERS ==== */
 
@@ -321,13 +363,21 @@ static obj_t* __vec_constructor(obj_t *_self, va_list *app){
 	self->vec.w = (float)(va_arg(*app,double));
 	return self;
 }
-static void __vec_print(const obj_t *_self, FILE *f){
-	vec_obj *self = (vec_obj*)_self;
-	fprintf(f,"<%f %f %f %f>\n",self->vec.x,self->vec.y,self->vec.z,self->vec.w);
+static void write_floats(writer_t *w, const float *v, int count){
+	int i;
+	writer_char(w,'<');
+	for(i = 0; i < count; i++){
+		if(i){
+			writer_char(w,' ');
+		}
+		writer_float(w,v[i]);
+	}
+	writer_char(w,'>');
 }
-static obj_t* __vec_destructor(obj_t*_self){
-	fprintf(stdout,"DESTR Vec:%s\n",obj(_self)->name);
-	return _self;
+static void __vec_print(const obj_t *_self, writer_t *w){
+	vec_obj *self = (vec_obj*)_self;
+	write_floats(w,tab(&self->vec),4);
+	writer_char(w,'\n');
 }
 static int __vec_equals(const obj_t *_self, const obj_t *_b){
 	vec_obj *self = (vec_obj*)_self;
@@ -350,16 +400,29 @@ static unsigned int __vec_hash(const obj_t *_self){
 	hash += (((int)(self->vec.w*1000)) * -7) %1073741824;
 	return hash % 1073741824;
 }
+static klass_info_t vec_info;
 const klass_t vec_klass = {
 	&object_klass,
 	sizeof(vec_obj),
 	"Vector",
 	__vec_constructor,
-	__vec_destructor,
+	NULL,	//destructor
 	NULL,
 	__vec_equals,
 	__vec_print,
-	__vec_hash	
+	__vec_hash,
+	NULL,	//to
+	NULL,	//get
+	NULL,	//get_index
+	NULL,	//set
+	NULL,	//set_index
+	NULL,	//append
+	NULL,	//rem
+	NULL,	//rem_index
+	NULL,	//len
+	NULL,	//iterator
+	NULL,	//traverse
+	&vec_info	//info
 };
 const klass_t * Vec = &vec_klass;
 
@@ -367,7 +430,7 @@ vec3_t *vec_get_vec3(obj_t* vec){
 	if(obj_instance_of(vec,Vec)){
 		return (vec3_t*)(&((vec_obj*)vec)->vec);
 	}else{
-		fprintf(stderr,"ERROR: vec_get_vec3(): %s is not a Vec\n",obj(vec)->name);
+		fprintf(stderr,"ERROR: vec_get_vec3(): %s is not a Vec\n",obj_name(vec));
 		return NULL;
 	}
 }
@@ -375,7 +438,7 @@ vec4_t *vec_get_vec4(obj_t* vec){
 	if(obj_instance_of(vec,Vec)){
 		return &((vec_obj*)vec)->vec;
 	}else{
-		fprintf(stderr,"ERROR: vec_get_vec4(): %s is not a Vec\n",obj(vec)->name);
+		fprintf(stderr,"ERROR: vec_get_vec4(): %s is not a Vec\n",obj_name(vec));
 		return NULL;
 	}
 }
@@ -385,47 +448,66 @@ static obj_t* __mat_constructor(obj_t *_self, va_list *app){
 	mat4_copy(&(self->mat),(mat4_t*)(va_arg(*app,mat4_t*)));
 	return self;
 }
-static void __mat_print(const obj_t *_self, FILE *f){
+static void __mat_print(const obj_t *_self, writer_t *w){
 	mat_obj *self = (mat_obj*)_self;
-	mat4_t *m = &(self->mat);
-	fprintf(f,"<<%f %f %f %f>\n <%f %f %f %f>\n <%f %f %f %f>\n <%f %f %f %f>>\n",
-			m->xx, m->xy, m->xz, m->xw,
-			m->yx, m->yy, m->yz, m->yw,
-			m->zx, m->zy, m->zz, m->zw,
-			m->wx, m->wy, m->wz, m->ww );
-}
-static obj_t* __mat_destructor(obj_t*_self){
-	fprintf(stdout,"DESTR Mat:%s\n",obj(_self)->name);
-	return _self;
+	int i;
+	writer_char(w,'<');
+	for(i = 0; i < 4; i++){
+		if(i){
+			writer_char(w,' ');
+		}
+		write_floats(w,tab(&self->mat) + i*4,4);
+		writer_char(w,i < 3 ? '\n' : '>');
+	}
+	writer_char(w,'\n');
 }
 static int __mat_equals(const obj_t *_self, const obj_t *_b){
-	//vec_obj *self = (vec_obj*)_self;
-	//vec_obj *b    = (vec_obj*)_b;
-	/*TODO*/
-	printf("FIXME: Implement Mat Equals\n");
-	return 0;
+	const float *m = tab(&((const mat_obj*)_self)->mat);
+	const float *b = tab(&((const mat_obj*)_b)->mat);
+	int i;
+	for(i = 0; i < 16; i++){
+		if(m[i] != b[i]){
+			return 0;
+		}
+	}
+	return 1;
 }
+/* mixes the bits of the elements, -0 is hashed as 0 to agree with equals */
 static unsigned int __mat_hash(const obj_t *_self){
-	mat_obj *self = (mat_obj*)_self;
-	int hash = 1;
-	float *m = (float*)(&(self->mat));
-	int f[] = {1,-2,3,-5,7,-11,13,-17,19,-23,29,-31,37,-41,43,-47};
-	int i = 16;
-	while(i--){
-		hash = (hash + f[i]*(int)(m[i]*1000) + hash*(int)(m[i]*1000) ) % 1073741824; 
+	const float *m = tab(&((const mat_obj*)_self)->mat);
+	unsigned int h = 0x3c6ef372u;
+	int i;
+	for(i = 0; i < 16; i++){
+		float f = m[i] + 0.0f;
+		uint32_t bits;
+		memcpy(&bits,&f,sizeof(float));
+		h = obj_hash_combine(h,bits);
 	}
-	return (unsigned int)(hash % 1073741824);
+	return obj_hash_finish(h);
 }
+static klass_info_t mat_info;
 const klass_t mat_klass = {
 	&object_klass,
 	sizeof(mat_obj),
 	"Matrix",
 	__mat_constructor,
-	__mat_destructor,
+	NULL,	//destructor
 	NULL,
 	__mat_equals,
 	__mat_print,
-	__mat_hash	
+	__mat_hash,
+	NULL,	//to
+	NULL,	//get
+	NULL,	//get_index
+	NULL,	//set
+	NULL,	//set_index
+	NULL,	//append
+	NULL,	//rem
+	NULL,	//rem_index
+	NULL,	//len
+	NULL,	//iterator
+	NULL,	//traverse
+	&mat_info	//info
 };
 const klass_t * Mat = &mat_klass;
 
@@ -433,23 +515,279 @@ mat4_t *mat_get_mat4(obj_t* mat){
 	if(obj_instance_of(mat,Mat)){
 		return (mat4_t*)(&((mat_obj*)mat)->mat);
 	}else{
-		fprintf(stderr,"ERROR: mat_get_mat4(): %s is not a Mat\n",obj(mat)->name);
+		fprintf(stderr,"ERROR: mat_get_mat4(): %s is not a Mat\n",obj_name(mat));
 		return NULL;
 	}
 }
 
-int main(int argc, char **argv){
-	mat4_t *m = mat4_zero(mat4_new());
-	obj_t *v1 = obj_new(Vec,1.0,2.0,3.0,4.0);
-	obj_t *f1 = obj_new(Float,3.14);
-	obj_t *m1 = obj_new(Mat,m);
+/*	VECTOR ARRAYS	*/
+/* Vec3Array and Vec4Array store vectors unboxed, either interleaved
+ * (VEC_AOS, the data is a vec3_t[] or vec4_t[]) or as one float plane
+ * per component (VEC_SOA, plane c starts at data + c*capacity).
+ * obj_new(Vec3Array,length,layout) creates length zero vectors.
+ * obj_get_index() boxes an element in a Vec owned by the open pool, see
+ * obj_box(), vecarray_get() reads it without a box. */
+static int vecarray_width(const obj_t *self){
+	return obj_instance_of((obj_t*)self,Vec4Array) ? 4 : 3;
+}
+static float *vecarray_at(const vecarray_obj *self, int index, int c){
+	if(self->layout == VEC_SOA){
+		return self->data + c*self->capacity + index;
+	}else{
+		return self->data + index*self->width + c;
+	}
+}
+static int vecarray_grow(vecarray_obj *self, int capacity){
+	float *d;
+	int c;
+	if(capacity <= self->capacity){
+		return 1;
+	}
+	if(self->storage){
+		d = (float*)malloc(capacity*self->width*sizeof(float));
+	}else{
+		d = (float*)realloc(self->data,capacity*self->width*sizeof(float));
+	}
+	if(!d){
+		fprintf(stderr,"ERROR: %s : could not grow %s to %d elements\n",obj_klass(self)->name,obj_name(self),capacity);
+		return 0;
+	}
+	if(self->storage){
+		/* borrowed data is copied, planes included */
+		if(self->layout == VEC_SOA){
+			for(c = 0; c < self->width; c++){
+				memcpy(d + c*capacity,self->data + c*self->capacity,self->length*sizeof(float));
+			}
+		}else{
+			memcpy(d,self->data,self->length*self->width*sizeof(float));
+		}
+		obj_unref(self->storage);
+		self->storage = NULL;
+		HEAP_ALLOC(HEAP_NUMBERS,capacity*self->width*sizeof(float));
+	}else{
+		HEAP_RESIZE(HEAP_NUMBERS,self->capacity*self->width*sizeof(float),capacity*self->width*sizeof(float));
+		if(self->layout == VEC_SOA){
+			/* planes move up, the last one first so none is overwritten */
+			for(c = self->width - 1; c > 0; c--){
+				memmove(d + c*capacity,d + c*self->capacity,self->length*sizeof(float));
+			}
+		}
+	}
+	self->data = d;
+	self->capacity = capacity;
+	return 1;
+}
+static int is_vecarray(const obj_t *self, const char *fn){
+	if(self && (obj_instance_of((obj_t*)self,Vec3Array) || obj_instance_of((obj_t*)self,Vec4Array))){
+		return 1;
+	}else{
+		fprintf(stderr,"ERROR: %s(): %s is not a vector array\n",fn,self ? obj_name(self) : "NULL");
+		return 0;
+	}
+}
+static obj_t* __vecarray_constructor(obj_t *_self, va_list *app){
+	vecarray_obj *self = (vecarray_obj*)_self;
+	int length = va_arg(*app,int);
+	self->layout = va_arg(*app,int) == VEC_SOA ? VEC_SOA : VEC_AOS;
+	self->width = vecarray_width(_self);
+	if(length > 0){
+		if(!vecarray_grow(self,length)){
+			return NULL;
+		}
+		memset(self->data,0,length*self->width*sizeof(float));
+		self->length = length;
+	}
+	return _self;
+}
+static obj_t* __vecarray_destructor(obj_t *_self){
+	vecarray_obj *self = (vecarray_obj*)_self;
+	if(self->storage){
+		obj_unref(self->storage);
+	}else{
+		HEAP_FREE(HEAP_NUMBERS,self->capacity*self->width*sizeof(float));
+		free(self->data);
+	}
+	return _self;
+}
+/* the clone gets a copy of the data, borrowed data included */
+static obj_t* __vecarray_clone(obj_t *_self){
+	const vecarray_obj *self = (const vecarray_obj*)_self;
+	vecarray_obj *c = (vecarray_obj*)obj_copy(_self);
+	int i;
+	if(!c){
+		return NULL;
+	}
+	c->storage = NULL;
+	c->data = NULL;
+	c->capacity = 0;
+	c->length = 0;
+	if(self->length && !vecarray_grow(c,self->length)){
+		obj_unref(c);
+		return NULL;
+	}
+	c->length = self->length;
+	if(self->layout == VEC_SOA){
+		for(i = 0; i < self->width; i++){
+			memcpy(c->data + i*c->capacity,self->data + i*self->capacity,self->length*sizeof(float));
+		}
+	}else{
+		memcpy(c->data,self->data,self->length*self->width*sizeof(float));
+	}
+	return c;
+}
+static void __vecarray_print(const obj_t *_self, writer_t *w){
+	const vecarray_obj *self = (const vecarray_obj*)_self;
+	int i, c;
+	writer_char(w,'[');
+	for(i = 0; i < self->length; i++){
+		float v[4];
+		for(c = 0; c < self->width; c++){
+			v[c] = *vecarray_at(self,i,c);
+		}
+		write_floats(w,v,self->width);
+		writer_char(w,' ');
+	}
+	writer_char(w,']');
+}
+static int __vecarray_len(const obj_t *_self){
+	return ((const vecarray_obj*)_self)->length;
+}
+static obj_t* __vecarray_get_index(const obj_t *_self, int index){
+	vec4_t v = {0.0f, 0.0f, 0.0f, 0.0f};
+	if(index < 0 || index >= ((const vecarray_obj*)_self)->length){
+		fprintf(stderr,"ERROR: __vecarray_get_index() : index %d out of range [0,%d[\n",index,((const vecarray_obj*)_self)->length);
+		return NULL;
+	}
+	vecarray_get(_self,index,tab(&v));
+	return obj_box(obj_new(Vec,(double)v.x,(double)v.y,(double)v.z,(double)v.w),"obj_get_index");
+}
+static void __vecarray_set_index(obj_t *self, int index, obj_t *data){
+	vec4_t *v = vec_get_vec4(data);
+	if(v){
+		vecarray_set(self,index,tab(v));
+	}
+}
+static void __vecarray_append(obj_t *self, obj_t *data){
+	vec4_t *v = vec_get_vec4(data);
+	if(v){
+		vecarray_append(self,tab(v));
+	}
+}
+static klass_info_t vec3array_info;
+const klass_t vec3array_klass = {
+	&object_klass,
+	sizeof(vecarray_obj),
+	"Vec3Array",
+	__vecarray_constructor,
+	__vecarray_destructor,
+	__vecarray_clone,
+	NULL,	//equals
+	__vecarray_print,
+	NULL,	//hash
+	NULL,	//to
+	NULL,	//get
+	__vecarray_get_index,
+	NULL,	//set
+	__vecarray_set_index,
+	__vecarray_append,
+	NULL,	//rem
+	NULL,	//rem_index
+	__vecarray_len,
+	obj_iter_index,
+	NULL,	//traverse
+	&vec3array_info	//info
+};
+const klass_t * Vec3Array = &vec3array_klass;
 
-	obj_print(v1,stdout);
-	obj_print(f1,stdout);
-	obj_print(m1,stdout);
+static klass_info_t vec4array_info;
+const klass_t vec4array_klass = {
+	&object_klass,
+	sizeof(vecarray_obj),
+	"Vec4Array",
+	__vecarray_constructor,
+	__vecarray_destructor,
+	__vecarray_clone,
+	NULL,	//equals
+	__vecarray_print,
+	NULL,	//hash
+	NULL,	//to
+	NULL,	//get
+	__vecarray_get_index,
+	NULL,	//set
+	__vecarray_set_index,
+	__vecarray_append,
+	NULL,	//rem
+	NULL,	//rem_index
+	__vecarray_len,
+	obj_iter_index,
+	NULL,	//traverse
+	&vec4array_info	//info
+};
+const klass_t * Vec4Array = &vec4array_klass;
 
-	obj_free(v1);
-	obj_free(f1);
-	obj_free(m1);
-	return 0;
+/* dst receives width floats */
+void	vecarray_get(const obj_t *_self, int index, float *dst){
+	const vecarray_obj *self = (const vecarray_obj*)_self;
+	int c;
+	if(!is_vecarray(_self,"vecarray_get")){
+		return;
+	}else if(index < 0 || index >= self->length){
+		fprintf(stderr,"ERROR: vecarray_get() : index %d out of range [0,%d[\n",index,self->length);
+		return;
+	}
+	for(c = 0; c < self->width; c++){
+		dst[c] = *vecarray_at(self,index,c);
+	}
+}
+void	vecarray_set(obj_t *_self, int index, const float *src){
+	vecarray_obj *self = (vecarray_obj*)_self;
+	int c;
+	if(!is_vecarray(_self,"vecarray_set")){
+		return;
+	}else if(index < 0 || index >= self->length){
+		fprintf(stderr,"ERROR: vecarray_set() : index %d out of range [0,%d[\n",index,self->length);
+		return;
+	}
+	for(c = 0; c < self->width; c++){
+		*vecarray_at(self,index,c) = src[c];
+	}
+}
+int	vecarray_append(obj_t *_self, const float *src){
+	vecarray_obj *self = (vecarray_obj*)_self;
+	if(!is_vecarray(_self,"vecarray_append")){
+		return 0;
+	}
+	if(self->length == self->capacity){
+		if(!vecarray_grow(self,self->capacity ? self->capacity*2 : 4)){
+			return self->length;
+		}
+	}
+	self->length++;
+	vecarray_set(_self,self->length - 1,src);
+	return self->length;
+}
+vec3_t *vec3array_data(obj_t *self){
+	if(!self || !obj_instance_of(self,Vec3Array) || ((vecarray_obj*)self)->layout != VEC_AOS){
+		fprintf(stderr,"ERROR: vec3array_data(): %s is not an interleaved Vec3Array\n",self ? obj_name(self) : "NULL");
+		return NULL;
+	}
+	return (vec3_t*)((vecarray_obj*)self)->data;
+}
+vec4_t *vec4array_data(obj_t *self){
+	if(!self || !obj_instance_of(self,Vec4Array) || ((vecarray_obj*)self)->layout != VEC_AOS){
+		fprintf(stderr,"ERROR: vec4array_data(): %s is not an interleaved Vec4Array\n",self ? obj_name(self) : "NULL");
+		return NULL;
+	}
+	return (vec4_t*)((vecarray_obj*)self)->data;
+}
+/* component plane of a VEC_SOA array, 0 for x up to 3 for w */
+float	*vecarray_plane(obj_t *_self, int c){
+	vecarray_obj *self = (vecarray_obj*)_self;
+	if(!is_vecarray(_self,"vecarray_plane")){
+		return NULL;
+	}else if(self->layout != VEC_SOA || c < 0 || c >= self->width){
+		fprintf(stderr,"ERROR: vecarray_plane(): %s has no plane %d\n",obj_name(_self),c);
+		return NULL;
+	}
+	return self->data + c*self->capacity;
 }
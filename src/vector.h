@@ -39,6 +39,8 @@ vec3_t *vec3_abs(vec3_t *dst);
 vec3_t *vec3_abs2(vec3_t *dst, const vec3_t *a);
 vec3_t *vec3_scale(vec3_t *dst,float factor);
 vec3_t *vec3_scale2(vec3_t *dst,const vec3_t *a, float factor);
+vec3_t *vec3_add_n(vec3_t *dst, const vec3_t *src, int count);
+vec3_t *vec3_scale_n(vec3_t *dst, float factor, int count);
 
 int	vec3_equals(const vec3_t *a, const vec3_t *b);
 int	vec3_equals_zero(const vec3_t *a);
@@ -101,6 +103,8 @@ mat4_t *mat4_rotate_quat(mat4_t *dst, const quat_t *rot);
 
 vec3_t *mat4_mult2_vec3(vec3_t *dst, const mat4_t *mat, const vec3_t *vec);
 vec4_t *mat4_mult2_vec4(vec4_t *dst, const mat4_t *mat, const vec4_t *vec);
+vec3_t *mat4_mult2_vec3_n(vec3_t *dst, const mat4_t *mat, const vec3_t *vec, int count);
+void	mat4_mult_soa(const mat4_t *mat, float *xs, float *ys, float *zs, int count);
 
 typedef struct bbox_s{
 	vec3_t min;
@@ -134,4 +138,23 @@ typedef struct bbox_obj{
 	bbox_t	 bbox;
 }bbox_obj;
 
+enum{ VEC_AOS, VEC_SOA };
+extern const klass_t *Vec3Array;
+extern const klass_t *Vec4Array;
+typedef struct vecarray_obj{
+	object_t ___;
+	int	length;
+	int	capacity;
+	int	width;		/* 3 or 4 floats per vector */
+	int	layout;		/* VEC_AOS or VEC_SOA */
+	float	*data;
+	obj_t	*storage;	/* when set, data is borrowed from it, copied on growth */
+}vecarray_obj;
+void	vecarray_get(const obj_t *self, int index, float *dst);
+void	vecarray_set(obj_t *self, int index, const float *src);
+int	vecarray_append(obj_t *self, const float *src);
+vec3_t *vec3array_data(obj_t *self);
+vec4_t *vec4array_data(obj_t *self);
+float	*vecarray_plane(obj_t *self, int c);
+
 #endif
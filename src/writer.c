@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "writer.h"
+
+void	writer_init(writer_t *w, FILE *file){
+	memset(w,0,sizeof(writer_t));
+	w->file = file;
+}
+void	writer_flush(writer_t *w){
+	if(w->file && w->length){
+		if(fwrite(w->data,1,w->length,w->file) != w->length){
+			w->error = 1;
+		}
+		w->length = 0;
+	}
+}
+void	writer_free(writer_t *w){
+	writer_flush(w);
+	free(w->data);
+	w->data = NULL;
+	w->length = w->capacity = 0;
+}
+/* the text is NUL terminated and belongs to the caller */
+char*	writer_detach(writer_t *w, size_t *length){
+	char *text;
+	if(!writer_reserve(w,1)){
+		return NULL;
+	}
+	w->data[w->length] = '\0';
+	text = w->data;
+	if(length){
+		*length = w->length;
+	}
+	w->data = NULL;
+	w->length = w->capacity = 0;
+	return text;
+}
+/* makes room for length more bytes, flushing first when bound to a file */
+int	writer_reserve(writer_t *w, size_t length){
+	size_t capacity;
+	char *d;
+	if(w->length + length <= w->capacity){
+		return 1;
+	}
+	if(w->file && w->length >= WRITER_FLUSH){
+		writer_flush(w);
+		if(length <= w->capacity){
+			return 1;
+		}
+	}
+	capacity = w->capacity ? w->capacity : 256;
+	while(capacity < w->length + length){
+		capacity *= 2;
+	}
+	d = (char*)realloc(w->data,capacity);
+	if(!d){
+		fprintf(stderr,"ERROR: writer_reserve() out of memory\n");
+		w->error = 1;
+		return 0;
+	}
+	w->data = d;
+	w->capacity = capacity;
+	return 1;
+}
+void	writer_bytes(writer_t *w, const char *s, size_t length){
+	if(writer_reserve(w,length)){
+		memcpy(w->data + w->length,s,length);
+		w->length += length;
+	}
+}
+void	writer_string(writer_t *w, const char *s){
+	writer_bytes(w,s,strlen(s));
+}
+/* digits are produced backwards into a small buffer */
+static void write_digits(writer_t *w, unsigned long long v, int neg, int min_digits){
+	char buf[24];
+	char *p = buf + sizeof(buf);
+	while(v || min_digits > 0){
+		*--p = '0' + v % 10;
+		v /= 10;
+		min_digits--;
+	}
+	if(neg){
+		*--p = '-';
+	}
+	writer_bytes(w,p,buf + sizeof(buf) - p);
+}
+void	writer_int(writer_t *w, long long value){
+	if(value < 0){
+		write_digits(w,-(unsigned long long)value,1,1);
+	}else{
+		write_digits(w,(unsigned long long)value,0,1);
+	}
+}
+/* Six decimals. The value is rounded to millionths in integer
+ * arithmetic, large values, nan and inf are left to snprintf(). */
+void	writer_float(writer_t *w, double value){
+	double a = fabs(value), s = a*1e6;
+	/* printf rounds the exact binary value, the scaled product can only
+	 * be trusted away from a tie, which is left to snprintf */
+	if(a < 1e9 && fabs(s - floor(s) - 0.5) > s*2.3e-16){
+		unsigned long long m = (unsigned long long)(s + 0.5);
+		write_digits(w,m/1000000,signbit(value) != 0,1);
+		writer_char(w,'.');
+		write_digits(w,m%1000000,0,6);
+	}else{
+		char buf[352];
+		int n = snprintf(buf,sizeof(buf),"%f",value);
+		writer_bytes(w,buf,n);
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef __3DE_WRITER_H__
+#define __3DE_WRITER_H__
+#include <stdio.h>
+#include <stddef.h>
+
+/* Output buffer used by the print callbacks. A writer bound to a FILE
+ * hands its buffer to fwrite() only each time WRITER_FLUSH bytes have
+ * piled up and at writer_free(), a writer without one grows in memory
+ * until writer_detach() takes the text. Numbers are formatted by hand,
+ * writer_float() writes what printf("%f") would. */
+
+#define WRITER_FLUSH	65536
+
+typedef struct writer_s{
+	char	*data;
+	size_t	length;
+	size_t	capacity;
+	FILE	*file;
+	int	error;
+}writer_t;
+
+void	writer_init(writer_t *w, FILE *file);
+void	writer_flush(writer_t *w);
+void	writer_free(writer_t *w);
+char*	writer_detach(writer_t *w, size_t *length);
+
+int	writer_reserve(writer_t *w, size_t length);
+void	writer_bytes(writer_t *w, const char *s, size_t length);
+void	writer_string(writer_t *w, const char *s);
+void	writer_int(writer_t *w, long long value);
+void	writer_float(writer_t *w, double value);
+
+#define writer_char(w,c) do{ \
+	if((w)->length < (w)->capacity || writer_reserve((w),1)){ \
+		(w)->data[(w)->length++] = (c); \
+	} \
+}while(0)
+
+#endif
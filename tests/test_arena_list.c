@@ -0,0 +1,47 @@
+#include <stdio.h>
+#include <string.h>
+#include "object.h"
+
+/* A List created before an arena keeps the nodes it grows inside it:
+ * they must survive obj_arena_end(), as must the arena objects the List
+ * holds. Returns non zero on failure. */
+
+#define INSIDE	200
+#define AFTER	100
+
+static int failures = 0;
+
+#define CHECK(cond) \
+	if(!(cond)){ \
+		fprintf(stderr,"FAIL: %s:%d : %s\n",__FILE__,__LINE__,#cond); \
+		failures++; \
+	}
+
+int main(int argc, char **argv){
+	obj_t *list = obj_new(List);
+	int i;
+	list_append(list,tmp(obj_new(String,"before")));
+	obj_arena_begin();
+	for(i = 0; i < INSIDE; i++){
+		list_append(list,tmp(obj_new(Int,i)));
+		list_append(list,tmp(obj_new(String,"inside")));
+	}
+	obj_arena_end();
+	for(i = 0; i < AFTER; i++){
+		list_append(list,tmp(obj_new(Int,INSIDE + i)));
+	}
+	CHECK(list_length(list) == 1 + 2*INSIDE + AFTER);
+	CHECK(!strcmp(obj_string(list_get(list,0)),"before"));
+	for(i = 0; i < INSIDE; i++){
+		CHECK(obj_int(list_get(list,1 + 2*i)) == i);
+		CHECK(!strcmp(obj_string(list_get(list,2 + 2*i)),"inside"));
+	}
+	for(i = 0; i < AFTER; i++){
+		CHECK(obj_int(list_get(list,1 + 2*INSIDE + i)) == INSIDE + i);
+	}
+	obj_unref(list);
+	if(!failures){
+		printf("test_arena_list ok\n");
+	}
+	return failures != 0;
+}
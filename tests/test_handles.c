@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include "object.h"
+
+/* A freed slot of the handle table is the next one handed out: churning
+ * it must never bring a stale uid or weak handle back to life, and
+ * obj_walk() must find every live object, arena ones included. Returns
+ * non zero on failure. */
+
+#define CHURN	100000
+#define ARENA	40
+
+static int failures = 0;
+
+#define CHECK(cond) \
+	if(!(cond)){ \
+		fprintf(stderr,"FAIL: %s:%d : %s\n",__FILE__,__LINE__,#cond); \
+		failures++; \
+	}
+
+static void count(obj_t *self, void *ctx){
+	if(obj_by_uid(obj_uid(self)) == self){
+		(*(int*)ctx)++;
+	}
+}
+
+int main(int argc, char **argv){
+	obj_t *a = obj_new(Object), *o, *arena[ARENA];
+	obj_uid_t uid = obj_uid(a), last = uid;
+	obj_weak_t weak = obj_weak(a);
+	int i, stale = 0, fresh = 0, seen = 0;
+	CHECK(uid && obj_by_uid(uid) == a && obj_weak_get(weak) == a);
+	obj_unref(a);
+	for(i = 0; i < CHURN; i++){
+		o = obj_new(Object);
+		stale += obj_by_uid(uid) != NULL || obj_weak_get(weak) != NULL;
+		fresh += obj_uid(o) != last && obj_by_uid(obj_uid(o)) == o;
+		last = obj_uid(o);
+		obj_unref(o);
+	}
+	CHECK(stale == 0);
+	CHECK(fresh == CHURN);
+	CHECK(obj_by_uid(last) == NULL);
+
+	/* arenas mix slot sizes */
+	o = obj_new(String,"outside");
+	obj_arena_begin();
+	for(i = 0; i < ARENA; i++){
+		arena[i] = i % 3 == 0 ? obj_new(Object) : i % 3 == 1 ? obj_new(String,"a string too long to be stored inline") : obj_new(List);
+	}
+	for(i = 0; i < ARENA; i += 4){
+		obj_unref(arena[i]);
+	}
+	CHECK(obj_walk(count,&seen) == 1 + ARENA - ARENA/4 && seen == 1 + ARENA - ARENA/4);
+	obj_arena_end();
+	seen = 0;
+	CHECK(obj_walk(count,&seen) == 1 + ARENA - ARENA/4 && seen == 1 + ARENA - ARENA/4);
+	for(i = 0; i < ARENA; i++){
+		if(i % 4){
+			obj_unref(arena[i]);
+		}
+	}
+	obj_unref(o);
+	seen = 0;
+	CHECK(obj_walk(count,&seen) == 0 && seen == 0);
+	if(!failures){
+		printf("test_handles ok\n");
+	}
+	return failures != 0;
+}
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parser.h"
+#include "vector.h"
+
+/* Prints a graph with obj_to_buffer() and parses the text back, whole
+ * and in chunks of every size from one byte up, so that keys, strings,
+ * escapes, numbers and words are split at every position. Every parse
+ * must give the same values, equal to the graph. Returns non zero on
+ * failure. */
+
+#define MAX_CHUNK	17
+
+static int failures = 0;
+
+#define CHECK(cond) \
+	if(!(cond)){ \
+		fprintf(stderr,"FAIL: %s:%d : %s\n",__FILE__,__LINE__,#cond); \
+		failures++; \
+	}
+
+static void set(obj_t *self, const char *field, obj_t *value){
+	obj_set_field(self,field,value);
+	obj_unref(value);
+}
+static void append(obj_t *array, obj_t *value){
+	array_append(array,value);
+	obj_unref(value);
+}
+
+/* everything the syntax holds but Objects, which never compare equal */
+static obj_t *new_scene(void){
+	obj_t *scene = obj_new(HashTable), *items = obj_new(Array,0), *nested = obj_new(Array,0);
+	obj_t *empty = obj_new(HashTable);
+	mat4_t m;
+	mat4_id(&m);
+	m.xw = 2.5f;
+	set(scene,"name",obj_new(String,"scene"));
+	set(scene,"escaped",obj_new(String,"a \"quoted\" \\ line\nand\ta tab"));
+	set(scene,"a_rather_long_key_that_will_be_split_many_times",obj_new(Int,7));
+	append(items,obj_new(Int,0));
+	append(items,obj_new(Int,-2147483647 - 1));
+	append(items,obj_new(Int,2147483647));
+	append(items,obj_new(Float,-3.5));
+	append(items,obj_new(Float,1.25e-3));
+	append(items,obj_new(Float,6.5e20));
+	append(items,obj_new(String,""));
+	array_append(items,NULL);
+	append(items,obj_new(Vec,1.0,-2.0,0.5,4.0));
+	append(items,obj_new(Mat,&m));
+	append(nested,obj_new(Array,0));
+	array_append(nested,empty);
+	array_append(items,nested);
+	set(scene,"items",items);
+	obj_unref(nested);
+	obj_unref(empty);
+	return scene;
+}
+
+typedef struct values_s{
+	obj_t	*array;
+}values_t;
+
+static void collect(obj_t *value, void *ctx){
+	append(((values_t*)ctx)->array,value);
+}
+/* parses text in chunks of chunk bytes, or whole when chunk is 0, into
+ * an Array of its top level values */
+static obj_t *parse(const char *text, size_t length, size_t chunk){
+	values_t values;
+	parser_t *p;
+	size_t at;
+	int ok = 1;
+	values.array = obj_new(Array,0);
+	p = parser_new(collect,&values);
+	if(!chunk){
+		chunk = length;
+	}
+	for(at = 0; ok && at < length; at += chunk){
+		ok = parser_feed(p,text + at,length - at < chunk ? length - at : chunk);
+	}
+	ok = ok && parser_end(p);
+	if(!ok){
+		fprintf(stderr,"chunks of %zu : %s\n",chunk,parser_error(p));
+		obj_unref(values.array);
+		values.array = NULL;
+	}
+	parser_free(p);
+	return values.array;
+}
+
+int main(int argc, char **argv){
+	obj_t *scene = new_scene(), *named = obj_new(Object), *anonymous = obj_new(Object);
+	obj_t *whole, *values;
+	char *text, *objects;
+	size_t length, objects_length, chunk;
+	int same = 0;
+	obj_set_name(named,"camera");
+	text = obj_to_buffer(scene,&length);
+	/* two top level values */
+	text = realloc(text,2*length + 2);
+	text[length] = '\n';
+	memcpy(text + length + 1,text,length);
+	length = 2*length + 1;
+	text[length] = 0;
+
+	whole = parse(text,length,0);
+	CHECK(whole && obj_len(whole) == 2);
+	if(!whole || obj_len(whole) != 2){
+		return 1;
+	}
+	CHECK(obj_equals(array_get(whole,0),scene));
+	CHECK(obj_equals(array_get(whole,1),scene));
+	for(chunk = 1; chunk <= MAX_CHUNK; chunk++){
+		values = parse(text,length,chunk);
+		same += values && obj_equals(values,whole);
+		obj_unref(values);
+	}
+	CHECK(same == MAX_CHUNK);
+
+	/* objects keep their explicit name only */
+	values = obj_new(Array,0);
+	array_append(values,named);
+	array_append(values,anonymous);
+	objects = obj_to_buffer(values,&objects_length);
+	obj_unref(values);
+	for(chunk = 0; chunk <= MAX_CHUNK; chunk++){
+		obj_t *o;
+		values = parse(objects,objects_length,chunk);
+		CHECK(values && obj_len(values) == 1 && obj_len(o = array_get(values,0)) == 2);
+		if(values && obj_len(values) == 1 && obj_len(o) == 2){
+			CHECK(obj_klass(array_get(o,0)) == Object && !strcmp(obj_name(array_get(o,0)),"camera"));
+			CHECK(obj_klass(array_get(o,1)) == Object && strcmp(obj_name(array_get(o,1)),obj_name(anonymous)));
+		}
+		obj_unref(values);
+	}
+
+	free(text);
+	free(objects);
+	obj_unref(whole);
+	obj_unref(scene);
+	obj_unref(named);
+	obj_unref(anonymous);
+	if(!failures){
+		printf("test_parser ok\n");
+	}
+	return failures != 0;
+}
@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "serial.h"
+#include "vector.h"
+
+/* Writes object graphs and reads them back through serial_read() and
+ * serial_map(): values compare equal, shared objects and cycles come back
+ * shared, borrowed Strings and typed arrays outlive their graph, and
+ * truncated or corrupt files are refused. Returns non zero on failure. */
+
+#define ELEMENTS	1000
+
+static int failures = 0;
+
+#define CHECK(cond) \
+	if(!(cond)){ \
+		fprintf(stderr,"FAIL: %s:%d : %s\n",__FILE__,__LINE__,#cond); \
+		failures++; \
+	}
+
+/* sets a field to a new object and drops the caller's reference */
+static void set(obj_t *self, const char *field, obj_t *value){
+	obj_set_field(self,field,value);
+	obj_unref(value);
+}
+static void append(obj_t *list, obj_t *value){
+	list_append(list,value);
+	obj_unref(value);
+}
+
+/* a graph without cycles, comparable with obj_equals() */
+static obj_t *new_scene(void){
+	obj_t *scene = obj_new(HashTable), *list = obj_new(List), *array = obj_new(Array,0);
+	obj_t *config = obj_new(HashTable), *mat;
+	mat4_t m;
+	mat4_id(&m);
+	set(scene,"name",obj_new(String,"scene"));
+	set(scene,"path",obj_new(String,"a path that is far too long to be stored inline"));
+	set(scene,"count",obj_new(Int,-42));
+	set(scene,"scale",obj_new(Float,0.5));
+	append(list,obj_new(Int,1));
+	append(list,obj_new(String,"two"));
+	list_append(list,NULL);
+	append(list,obj_new(Vec,1.0,2.0,3.0,4.0));
+	array_append(array,list);
+	mat = obj_new(Mat,&m);
+	array_append(array,mat);
+	obj_unref(mat);
+	set(config,"depth",obj_new(Int,3));
+	set(scene,"config",config);
+	set(scene,"list",list);
+	set(scene,"array",array);
+	return scene;
+}
+/* typed arrays in every layout, and a shared object in a cycle */
+static obj_t *new_arrays(void){
+	obj_t *root = obj_new(Object), *node = obj_new(Object), *list = obj_new(List);
+	obj_t *floats = obj_new(FloatArray,0), *ints = obj_new(IntArray,0);
+	obj_t *soa = obj_new(Vec3Array,0,VEC_SOA), *aos = obj_new(Vec4Array,0,VEC_AOS);
+	int i;
+	for(i = 0; i < ELEMENTS; i++){
+		float v[4] = {i, i + 0.5f, -i, 2*i};
+		floatarray_append(floats,i*0.25f);
+		intarray_append(ints,-i);
+		vecarray_append(soa,v);
+		vecarray_append(aos,v);
+	}
+	set(root,"floats",floats);
+	set(root,"ints",ints);
+	set(root,"soa",soa);
+	set(root,"aos",aos);
+	list_append(list,node);
+	list_append(list,node);
+	list_append(list,root);
+	obj_set_field(node,"self",node);
+	set(root,"list",list);
+	obj_unref(node);
+	return root;
+}
+/* breaks the cycles of a graph made by new_arrays() */
+static void free_arrays(obj_t *root){
+	obj_t *list = obj_get_field(root,"list");
+	if(list_length(list) == 3){
+		obj_set_field(list_get(list,0),"self",NULL);
+		list_remove(list,2);
+	}
+	obj_unref(root);
+}
+static void check_arrays(obj_t *root){
+	obj_t *list = obj_get_field(root,"list");
+	obj_t *soa = obj_get_field(root,"soa"), *aos = obj_get_field(root,"aos");
+	float v[4];
+	int i, wrong = 0;
+	CHECK(list && list_length(list) == 3);
+	if(!list || list_length(list) != 3){
+		return;
+	}
+	CHECK(list_get(list,0) == list_get(list,1));
+	CHECK(list_get(list,2) == root);
+	CHECK(obj_get_field(list_get(list,0),"self") == list_get(list,0));
+	CHECK(obj_len(obj_get_field(root,"floats")) == ELEMENTS);
+	CHECK(obj_len(soa) == ELEMENTS && ((vecarray_obj*)soa)->layout == VEC_SOA);
+	CHECK(obj_len(aos) == ELEMENTS && ((vecarray_obj*)aos)->layout == VEC_AOS);
+	for(i = 0; i < ELEMENTS; i++){
+		wrong += floatarray_data(obj_get_field(root,"floats"))[i] != i*0.25f;
+		wrong += intarray_data(obj_get_field(root,"ints"))[i] != -i;
+		wrong += vecarray_plane(soa,1)[i] != i + 0.5f;
+		vecarray_get(soa,i,v);
+		wrong += v[0] != i || v[1] != i + 0.5f || v[2] != -i;
+		vecarray_get(aos,i,v);
+		wrong += v[0] != i || v[1] != i + 0.5f || v[2] != -i || v[3] != 2*i;
+	}
+	CHECK(wrong == 0);
+}
+/* writes root to a new temporary file, returns its contents */
+static char *write_file(const obj_t *root, char *path, size_t *size){
+	int fd = mkstemp(path);
+	FILE *f = fd < 0 ? NULL : fdopen(fd,"w+b");
+	char *data = NULL;
+	if(!f){
+		return NULL;
+	}
+	*size = serial_write(f,root);
+	if(*size && (data = malloc(*size))){
+		rewind(f);
+		if(fread(data,1,*size,f) != *size){
+			free(data);
+			data = NULL;
+		}
+	}
+	fclose(f);
+	return data;
+}
+/* writes size bytes of data to path */
+static void rewrite_file(const char *path, const char *data, size_t size){
+	FILE *f = fopen(path,"wb");
+	if(f){
+		fwrite(data,1,size,f);
+		fclose(f);
+	}
+}
+
+int main(int argc, char **argv){
+	char scene_path[] = "/tmp/test_serial_XXXXXX", arrays_path[] = "/tmp/test_serial_XXXXXX";
+	obj_t *scene = new_scene(), *arrays = new_arrays(), *o, *name, *floats, *soa;
+	size_t scene_size = 0, arrays_size = 0;
+	char *scene_data = write_file(scene,scene_path,&scene_size);
+	char *arrays_data = write_file(arrays,arrays_path,&arrays_size);
+	serial_header_t *h;
+	CHECK(scene_data && arrays_data);
+	if(!scene_data || !arrays_data){
+		return 1;
+	}
+
+	/* copied */
+	o = serial_read(scene_data,scene_size);
+	CHECK(o && obj_equals(o,scene));
+	obj_unref(o);
+	o = serial_read(arrays_data,arrays_size);
+	CHECK(o != NULL);
+	if(o){
+		check_arrays(o);
+		free_arrays(o);
+	}
+
+	/* mapped */
+	o = serial_map(scene_path);
+	CHECK(o && obj_equals(o,scene));
+	obj_unref(o);
+	o = serial_map(arrays_path);
+	CHECK(o != NULL);
+	if(o){
+		check_arrays(o);
+		free_arrays(o);
+	}
+
+	/* borrowed data outlives the graph and the Mapping that holds it */
+	o = serial_map(scene_path);
+	name = obj_ref(obj_get_field(o,"path"));
+	obj_unref(o);
+	o = serial_map(arrays_path);
+	floats = obj_ref(obj_get_field(o,"floats"));
+	soa = obj_ref(obj_get_field(o,"soa"));
+	free_arrays(o);
+	CHECK(!strcmp(obj_string(name),"a path that is far too long to be stored inline"));
+	CHECK(floatarray_data(floats)[ELEMENTS - 1] == (ELEMENTS - 1)*0.25f);
+	CHECK(vecarray_plane(soa,2)[ELEMENTS - 1] == -(ELEMENTS - 1));
+	CHECK(obj_alloc_stats(Mapping)->live == 2);
+	obj_unref(name);
+	obj_unref(floats);
+	obj_unref(soa);
+	CHECK(obj_alloc_stats(Mapping)->live == 0);
+
+	/* truncated */
+	CHECK(serial_read(scene_data,scene_size - 8) == NULL);
+	CHECK(serial_read(scene_data,sizeof(serial_header_t) - 1) == NULL);
+	rewrite_file(scene_path,scene_data,scene_size/2);
+	CHECK(serial_map(scene_path) == NULL);
+	CHECK(obj_alloc_stats(Mapping)->live == 0);
+
+	/* corrupt */
+	h = (serial_header_t*)scene_data;
+	h->root += 8;
+	CHECK(serial_read(scene_data,scene_size) == NULL);
+	h->root -= 8;
+	h->version++;
+	CHECK(serial_read(scene_data,scene_size) == NULL);
+	h->version--;
+	h->magic = ~h->magic;
+	CHECK(serial_read(scene_data,scene_size) == NULL);
+	CHECK(serial_read("garbage",7) == NULL);
+
+	unlink(scene_path);
+	unlink(arrays_path);
+	free(scene_data);
+	free(arrays_data);
+	obj_unref(scene);
+	free_arrays(arrays);
+	if(!failures){
+		printf("test_serial ok\n");
+	}
+	return failures != 0;
+}